@@ -0,0 +1,688 @@
+#include "../extras/extras.h"
+#include "../src/datagen.h"
+#include "../src/engine.h"
+#include "../src/parallel.h"
+#include "../src/radix.h"
+#include "../src/simd.h"
+#include "../src/small_sort.h"
+#include "../src/sort_types.h"
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Benchmarks every algorithm, both the one-shot reference implementations
+// in extras/ and the stepwise state machines in src/, across input sizes
+// and distributions. Each case runs in a forked child process so that a
+// crash or timeout only fails that case and so that peak RSS can be
+// measured per case.
+//
+// usage: bench [--format csv|json] [--min-n N] [--max-n N]
+//              [--max-quadratic-n N] [--reps N] [--timeout SECONDS]
+//              [--seed N] [--algorithm NAME] [--distribution NAME]
+//              [--threads N] [--min-threads N] [--simd LEVEL]
+//
+// Parallel algorithms run once per thread count, doubling from --min-threads
+// up to --threads, so `--min-threads 1` gives a scaling table. Algorithms
+// built on the kernels of simd.h run once per SIMD level from scalar up to
+// --simd (default: the best level the CPU supports), elements_per_sec gives
+// their throughput per level.
+//
+// The instantiations of sort_generic.h run on the same inputs converted to
+// their element type, bytes_per_sec shows how the element width affects the
+// memory bandwidth a sort needs.
+
+#define VALUE_MIN 0
+#define VALUE_MAX (1 << 30)
+
+enum Form {
+    ONE_SHOT,
+    STEPWISE,
+};
+
+enum Status {
+    STATUS_OK,
+    STATUS_UNSORTED,
+    STATUS_CRASHED,
+    STATUS_TIMEOUT,
+};
+
+static const char* const STATUS_NAMES[] = {
+    [STATUS_OK] = "ok",
+    [STATUS_UNSORTED] = "unsorted",
+    [STATUS_CRASHED] = "crashed",
+    [STATUS_TIMEOUT] = "timeout",
+};
+
+// sorts arr and returns the number of steps taken, 0 for one-shot sorts
+typedef long long (*SortFn)(int* arr, int len);
+// the same for an array of BenchAlgorithm.element
+typedef long long (*TypedSortFn)(void* arr, int len);
+
+// element type of a generic sort, see sort_types.h
+struct BenchElement {
+    const char* name;
+    size_t size;
+    // the generated ints in the element type, keeping their order
+    void (*convert)(const int* src, void* dst, int len);
+    bool (*is_sorted)(const void* arr, int len);
+};
+
+struct BenchAlgorithm {
+    const char* name;
+    enum Form form;
+    bool quadratic; // limited to --max-quadratic-n elements
+    SortFn sort;
+    bool parallel; // runs on --threads threads
+    bool simd;     // runs once per SIMD level
+    // set for the generic sorts, which run typed_sort instead of sort
+    const struct BenchElement* element;
+    TypedSortFn typed_sort;
+};
+
+struct BenchConfig {
+    bool json;
+    int min_n;
+    int max_n;
+    int max_quadratic_n;
+    int reps;
+    int timeout_s;
+    uint64_t seed;
+    const char* algorithm; // NULL runs all algorithms
+    int distribution;      // -1 runs all distributions
+    int threads;
+    int min_threads; // 0 runs the parallel algorithms with --threads only
+    enum SimdLevel simd_level;
+};
+
+struct BenchResult {
+    enum Status status;
+    double seconds; // best of all repetitions
+    long long steps;
+    long peak_rss_kb;
+};
+
+// ================== Sort wrappers ==================
+// thread count of the parallel algorithms, SortFn has no room for it, set
+// before the child process of each case is forked
+static int num_threads = 1;
+
+static long long run_merge_sort_recursive(int* arr, int len) {
+    merge_sort_recursive(arr, 0, len - 1);
+    return 0;
+}
+
+static long long run_merge_sort_iterative_v1(int* arr, int len) {
+    merge_sort_iterative_v1(arr, len);
+    return 0;
+}
+
+static long long run_merge_sort_iterative_v2(int* arr, int len) {
+    merge_sort_iterative_v2(arr, len);
+    return 0;
+}
+
+static long long run_quick_sort_recursive(int* arr, int len) {
+    quick_sort_recursive(arr, 0, len - 1);
+    return 0;
+}
+
+static long long run_quick_sort_iterative(int* arr, int len) {
+    quick_sort_iterative(arr, len);
+    return 0;
+}
+
+static long long run_parallel_merge_sort(int* arr, int len) {
+    // leaves arr unsorted if the scratch buffer cannot be allocated
+    parallel_merge_sort(arr, len, num_threads);
+    return 0;
+}
+
+static long long run_parallel_quick_sort(int* arr, int len) {
+    parallel_quick_sort(arr, len, num_threads);
+    return 0;
+}
+
+static long long run_simd_merge_sort(int* arr, int len) {
+    simd_merge_sort(arr, len);
+    return 0;
+}
+
+static long long run_simd_quick_sort(int* arr, int len) {
+    simd_quick_sort(arr, len);
+    return 0;
+}
+
+static long long run_radix_lsd_sort(int* arr, int len) {
+    // leaves arr unsorted if the scratch buffer cannot be allocated
+    radix_lsd_sort(arr, len);
+    return 0;
+}
+
+static long long run_radix_msd_sort(int* arr, int len) {
+    radix_msd_sort(arr, len);
+    return 0;
+}
+
+static long long run_selection_sort(int* arr, int len) {
+    selection_sort(arr, len);
+    return 0;
+}
+
+static long long run_insertion_sort(int* arr, int len) {
+    insertion_sort(arr, len);
+    return 0;
+}
+
+static long long run_binary_insertion_sort(int* arr, int len) {
+    binary_insertion_sort(arr, len);
+    return 0;
+}
+
+static long long run_engine_with(enum AlgorithmType type, int* arr, int len, bool fast_path) {
+    struct Engine engine;
+    engine_init(&engine, type, arr, len);
+    engine_set_fast_path(&engine, fast_path);
+    long long steps = engine_run(&engine);
+    engine_free(&engine);
+    return steps;
+}
+
+static long long run_engine(enum AlgorithmType type, int* arr, int len) {
+    return run_engine_with(type, arr, len, false);
+}
+
+static long long run_selection_sort_step(int* arr, int len) {
+    return run_engine(SELECTION_SORT, arr, len);
+}
+
+static long long run_insert_sort_step(int* arr, int len) {
+    return run_engine(INSERT_SORT, arr, len);
+}
+
+static long long run_merge_sort_step(int* arr, int len) {
+    return run_engine(MERGE_SORT, arr, len);
+}
+
+static long long run_merge_sort_step_fast(int* arr, int len) {
+    return run_engine_with(MERGE_SORT, arr, len, true);
+}
+
+static long long run_quick_sort_step(int* arr, int len) {
+    return run_engine(QUICK_SORT, arr, len);
+}
+
+static long long run_bubble_sort_step(int* arr, int len) {
+    return run_engine(BUBBLE_SORT, arr, len);
+}
+
+static long long run_intro_sort_step(int* arr, int len) {
+    return run_engine(INTRO_SORT, arr, len);
+}
+
+static long long run_parallel_merge_sort_step(int* arr, int len) {
+    return run_engine(PARALLEL_MERGE_SORT, arr, len);
+}
+
+static long long run_parallel_quick_sort_step(int* arr, int len) {
+    return run_engine(PARALLEL_QUICK_SORT, arr, len);
+}
+
+static long long run_binary_insert_sort_step(int* arr, int len) {
+    return run_engine(BINARY_INSERT_SORT, arr, len);
+}
+
+static long long run_radix_lsd_sort_step(int* arr, int len) {
+    return run_engine(RADIX_LSD_SORT, arr, len);
+}
+
+static long long run_radix_msd_sort_step(int* arr, int len) {
+    return run_engine(RADIX_MSD_SORT, arr, len);
+}
+
+static long long run_tim_sort_step(int* arr, int len) {
+    return run_engine(TIM_SORT, arr, len);
+}
+
+// ================== Element types ==================
+// every 64th float is a NaN, they have to end up at the end
+#define NAN_INTERVAL 64
+
+static void convert_u32(const int* src, void* dst, int len) {
+    uint32_t* out = dst;
+    for (int i = 0; i < len; i++) {
+        out[i] = (uint32_t)src[i];
+    }
+}
+
+static void convert_u64(const int* src, void* dst, int len) {
+    // the int in the high half keeps the order, the low half is noise so
+    // that all 64 bits take part in the comparisons
+    uint64_t* out = dst;
+    for (int i = 0; i < len; i++) {
+        out[i] = (uint64_t)src[i] << 32 | (uint32_t)(src[i] * 2654435761u);
+    }
+}
+
+static void convert_f32(const int* src, void* dst, int len) {
+    float* out = dst;
+    for (int i = 0; i < len; i++) {
+        out[i] = i % NAN_INTERVAL == NAN_INTERVAL - 1 ? NAN : src[i] / (float)VALUE_MAX;
+    }
+}
+
+static void convert_f64(const int* src, void* dst, int len) {
+    double* out = dst;
+    for (int i = 0; i < len; i++) {
+        out[i] = i % NAN_INTERVAL == NAN_INTERVAL - 1 ? NAN : src[i] / (double)VALUE_MAX;
+    }
+}
+
+static void convert_record16(const int* src, void* dst, int len) {
+    struct Record16* out = dst;
+    for (int i = 0; i < len; i++) {
+        out[i] = (struct Record16){(uint64_t)src[i], (uint64_t)i};
+    }
+}
+
+static bool is_sorted_u32(const void* arr, int len) {
+    const uint32_t* a = arr;
+    for (int i = 1; i < len; i++) {
+        if (a[i] < a[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_sorted_u64(const void* arr, int len) {
+    const uint64_t* a = arr;
+    for (int i = 1; i < len; i++) {
+        if (a[i] < a[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_sorted_f32(const void* arr, int len) {
+    const float* a = arr;
+    for (int i = 1; i < len; i++) {
+        if (FLOAT_LESS(a[i], a[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_sorted_f64(const void* arr, int len) {
+    const double* a = arr;
+    for (int i = 1; i < len; i++) {
+        if (FLOAT_LESS(a[i], a[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_sorted_record16(const void* arr, int len) {
+    const struct Record16* a = arr;
+    for (int i = 1; i < len; i++) {
+        if (a[i].key < a[i - 1].key) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const struct BenchElement ELEMENT_U32 = {"u32", sizeof(uint32_t), convert_u32, is_sorted_u32};
+static const struct BenchElement ELEMENT_U64 = {"u64", sizeof(uint64_t), convert_u64, is_sorted_u64};
+static const struct BenchElement ELEMENT_F32 = {"f32", sizeof(float), convert_f32, is_sorted_f32};
+static const struct BenchElement ELEMENT_F64 = {"f64", sizeof(double), convert_f64, is_sorted_f64};
+static const struct BenchElement ELEMENT_RECORD16 = {"record16",
+                                                     sizeof(struct Record16),
+                                                     convert_record16,
+                                                     is_sorted_record16};
+
+// the one-shot and the stepwise sort of an instantiation of sort_generic.h
+#define TYPED_SORT_WRAPPERS(name, state_struct)                         \
+    static long long run_##name##_sort(void* arr, int len) {            \
+        name##_sort(arr, len);                                          \
+        return 0;                                                       \
+    }                                                                   \
+    static long long run_##name##_merge_sort_step(void* arr, int len) { \
+        struct state_struct state;                                      \
+        name##_merge_sort_init(&state, arr, len);                       \
+        long long steps = 0;                                            \
+        while (!state.done) {                                           \
+            steps += name##_merge_sort_step_n(&state, 1 << 20);         \
+        }                                                               \
+        name##_merge_sort_free(&state);                                 \
+        return steps;                                                   \
+    }
+
+TYPED_SORT_WRAPPERS(u32, U32MergeSortState)
+TYPED_SORT_WRAPPERS(u64, U64MergeSortState)
+TYPED_SORT_WRAPPERS(f32, F32MergeSortState)
+TYPED_SORT_WRAPPERS(f64, F64MergeSortState)
+TYPED_SORT_WRAPPERS(record16, Record16MergeSortState)
+
+static const struct BenchAlgorithm ALGORITHMS[] = {
+    {"merge_sort_recursive", ONE_SHOT, false, run_merge_sort_recursive, false, false, NULL, NULL},
+    {"merge_sort_iterative_v1", ONE_SHOT, false, run_merge_sort_iterative_v1, false, false, NULL, NULL},
+    {"merge_sort_iterative_v2", ONE_SHOT, false, run_merge_sort_iterative_v2, false, false, NULL, NULL},
+    {"quick_sort_recursive", ONE_SHOT, false, run_quick_sort_recursive, false, false, NULL, NULL},
+    {"quick_sort_iterative", ONE_SHOT, false, run_quick_sort_iterative, false, false, NULL, NULL},
+    {"parallel_merge_sort", ONE_SHOT, false, run_parallel_merge_sort, true, false, NULL, NULL},
+    {"parallel_quick_sort", ONE_SHOT, false, run_parallel_quick_sort, true, false, NULL, NULL},
+    {"simd_merge_sort", ONE_SHOT, false, run_simd_merge_sort, false, true, NULL, NULL},
+    {"simd_quick_sort", ONE_SHOT, false, run_simd_quick_sort, false, true, NULL, NULL},
+    {"radix_lsd_sort", ONE_SHOT, false, run_radix_lsd_sort, false, false, NULL, NULL},
+    {"radix_msd_sort", ONE_SHOT, false, run_radix_msd_sort, false, false, NULL, NULL},
+    {"selection_sort", ONE_SHOT, true, run_selection_sort, false, false, NULL, NULL},
+    {"insertion_sort", ONE_SHOT, true, run_insertion_sort, false, false, NULL, NULL},
+    {"binary_insertion_sort", ONE_SHOT, true, run_binary_insertion_sort, false, false, NULL, NULL},
+    {"selection_sort_step", STEPWISE, true, run_selection_sort_step, false, false, NULL, NULL},
+    {"insert_sort_step", STEPWISE, true, run_insert_sort_step, false, false, NULL, NULL},
+    {"binary_insert_sort_step", STEPWISE, true, run_binary_insert_sort_step, false, false, NULL, NULL},
+    {"merge_sort_step", STEPWISE, false, run_merge_sort_step, false, false, NULL, NULL},
+    {"merge_sort_step_fast", STEPWISE, false, run_merge_sort_step_fast, false, true, NULL, NULL},
+    {"quick_sort_step", STEPWISE, false, run_quick_sort_step, false, false, NULL, NULL},
+    {"bubble_sort_step", STEPWISE, true, run_bubble_sort_step, false, false, NULL, NULL},
+    {"intro_sort_step", STEPWISE, false, run_intro_sort_step, false, false, NULL, NULL},
+    {"parallel_merge_sort_step", STEPWISE, false, run_parallel_merge_sort_step, false, false, NULL, NULL},
+    {"parallel_quick_sort_step", STEPWISE, false, run_parallel_quick_sort_step, false, false, NULL, NULL},
+    {"radix_lsd_sort_step", STEPWISE, false, run_radix_lsd_sort_step, false, false, NULL, NULL},
+    {"radix_msd_sort_step", STEPWISE, false, run_radix_msd_sort_step, false, false, NULL, NULL},
+    {"tim_sort_step", STEPWISE, false, run_tim_sort_step, false, false, NULL, NULL},
+    {"u32_sort", ONE_SHOT, false, NULL, false, false, &ELEMENT_U32, run_u32_sort},
+    {"u64_sort", ONE_SHOT, false, NULL, false, false, &ELEMENT_U64, run_u64_sort},
+    {"f32_sort", ONE_SHOT, false, NULL, false, false, &ELEMENT_F32, run_f32_sort},
+    {"f64_sort", ONE_SHOT, false, NULL, false, false, &ELEMENT_F64, run_f64_sort},
+    {"record16_sort", ONE_SHOT, false, NULL, false, false, &ELEMENT_RECORD16, run_record16_sort},
+    {"u32_merge_sort_step", STEPWISE, false, NULL, false, false, &ELEMENT_U32, run_u32_merge_sort_step},
+    {"u64_merge_sort_step", STEPWISE, false, NULL, false, false, &ELEMENT_U64, run_u64_merge_sort_step},
+    {"f32_merge_sort_step", STEPWISE, false, NULL, false, false, &ELEMENT_F32, run_f32_merge_sort_step},
+    {"f64_merge_sort_step", STEPWISE, false, NULL, false, false, &ELEMENT_F64, run_f64_merge_sort_step},
+    {"record16_merge_sort_step", STEPWISE, false, NULL, false, false, &ELEMENT_RECORD16, run_record16_merge_sort_step},
+};
+
+#define NUM_ALGORITHMS (int)(sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]))
+
+// ================== Measurement ==================
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool is_sorted(const int* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        if (arr[i - 1] > arr[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// runs in the child process, the result is written to fd
+static void run_case(const struct BenchAlgorithm* algorithm,
+                     enum Distribution dist,
+                     int len,
+                     const struct BenchConfig* config,
+                     int fd) {
+    struct BenchResult result = {STATUS_OK, 0.0, 0, 0};
+    const struct BenchElement* element = algorithm->element;
+    int* arr = malloc(len * sizeof(int));
+    void* data = element != NULL ? malloc(len * element->size) : NULL;
+    if (arr == NULL || (element != NULL && data == NULL)) {
+        _exit(EXIT_FAILURE);
+    }
+
+    for (int rep = 0; rep < config->reps; rep++) {
+        // regenerating and converting the input is not part of the
+        // measurement
+        generate(arr, len, dist, VALUE_MIN, VALUE_MAX, config->seed);
+        if (element != NULL) {
+            element->convert(arr, data, len);
+        }
+
+        double start = now_s();
+        long long steps = element != NULL ? algorithm->typed_sort(data, len) : algorithm->sort(arr, len);
+        double elapsed = now_s() - start;
+
+        if (element != NULL ? !element->is_sorted(data, len) : !is_sorted(arr, len)) {
+            result.status = STATUS_UNSORTED;
+        }
+        if (rep == 0 || elapsed < result.seconds) {
+            result.seconds = elapsed;
+        }
+        result.steps = steps;
+    }
+
+    free(arr);
+    free(data);
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(EXIT_FAILURE);
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+static struct BenchResult bench_case(const struct BenchAlgorithm* algorithm,
+                                     enum Distribution dist,
+                                     int len,
+                                     const struct BenchConfig* config) {
+    struct BenchResult result = {STATUS_CRASHED, 0.0, 0, 0};
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return result;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return result;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        // the default action of SIGALRM terminates the child
+        alarm(config->timeout_s);
+        run_case(algorithm, dist, len, config, fds[1]);
+    }
+
+    close(fds[1]);
+    struct BenchResult child_result;
+    bool got_result = read(fds[0], &child_result, sizeof(child_result)) == sizeof(child_result);
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        return result;
+    }
+
+    if (got_result && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        result = child_result;
+    } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+        result.status = STATUS_TIMEOUT;
+    }
+    result.peak_rss_kb = usage.ru_maxrss; // kilobytes on Linux
+    return result;
+}
+
+// ================== Reporting ==================
+static void report(const struct BenchConfig* config,
+                   const struct BenchAlgorithm* algorithm,
+                   enum Distribution dist,
+                   int len,
+                   int threads,
+                   const char* simd,
+                   const struct BenchResult* result,
+                   bool first) {
+    bool ok = result->status == STATUS_OK;
+    double ns_per_element = ok ? result->seconds * 1e9 / len : 0.0;
+    double elements_per_sec = ok && result->seconds > 0 ? len / result->seconds : 0.0;
+    double steps_per_sec = ok && result->seconds > 0 ? result->steps / result->seconds : 0.0;
+    const char* form = algorithm->form == STEPWISE ? "stepwise" : "one-shot";
+    const char* element = algorithm->element != NULL ? algorithm->element->name : "i32";
+    size_t element_size = algorithm->element != NULL ? algorithm->element->size : sizeof(int);
+    double bytes_per_sec = elements_per_sec * element_size;
+
+    if (config->json) {
+        printf("%s\n  {\"algorithm\": \"%s\", \"form\": \"%s\", \"distribution\": \"%s\", "
+               "\"n\": %d, \"threads\": %d, \"simd\": \"%s\", \"status\": \"%s\", \"seconds\": %.9f, "
+               "\"ns_per_element\": %.3f, \"elements_per_sec\": %.0f, \"steps\": %lld, \"steps_per_sec\": %.0f, "
+               "\"peak_rss_kb\": %ld, \"element\": \"%s\", \"bytes_per_sec\": %.0f}",
+               first ? "" : ",",
+               algorithm->name, form, distribution_name(dist), len, threads, simd,
+               STATUS_NAMES[result->status], result->seconds, ns_per_element, elements_per_sec,
+               result->steps, steps_per_sec, result->peak_rss_kb, element, bytes_per_sec);
+    } else {
+        printf("%s,%s,%s,%d,%d,%s,%s,%.9f,%.3f,%.0f,%lld,%.0f,%ld,%s,%.0f\n",
+               algorithm->name, form, distribution_name(dist), len, threads, simd,
+               STATUS_NAMES[result->status], result->seconds, ns_per_element, elements_per_sec,
+               result->steps, steps_per_sec, result->peak_rss_kb, element, bytes_per_sec);
+    }
+    fflush(stdout);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--format csv|json] [--min-n N] [--max-n N]\n"
+            "          [--max-quadratic-n N] [--reps N] [--timeout SECONDS]\n"
+            "          [--seed N] [--algorithm NAME] [--distribution NAME]\n"
+            "          [--threads N] [--min-threads N] [--simd LEVEL]\n",
+            prog);
+}
+
+static bool parse_args(int argc, char** argv, struct BenchConfig* config) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        i++;
+
+        if (strcmp(arg, "--format") == 0) {
+            if (strcmp(value, "json") != 0 && strcmp(value, "csv") != 0) {
+                return false;
+            }
+            config->json = strcmp(value, "json") == 0;
+        } else if (strcmp(arg, "--min-n") == 0) {
+            config->min_n = atoi(value);
+        } else if (strcmp(arg, "--max-n") == 0) {
+            config->max_n = atoi(value);
+        } else if (strcmp(arg, "--max-quadratic-n") == 0) {
+            config->max_quadratic_n = atoi(value);
+        } else if (strcmp(arg, "--reps") == 0) {
+            config->reps = atoi(value);
+        } else if (strcmp(arg, "--timeout") == 0) {
+            config->timeout_s = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            config->threads = atoi(value);
+        } else if (strcmp(arg, "--min-threads") == 0) {
+            config->min_threads = atoi(value);
+        } else if (strcmp(arg, "--simd") == 0) {
+            if (!parse_simd_level(value, &config->simd_level) || config->simd_level > simd_detect()) {
+                return false;
+            }
+        } else if (strcmp(arg, "--algorithm") == 0) {
+            config->algorithm = value;
+        } else if (strcmp(arg, "--distribution") == 0) {
+            enum Distribution dist;
+            if (!parse_distribution(value, &dist)) {
+                return false;
+            }
+            config->distribution = dist;
+        } else {
+            return false;
+        }
+    }
+    if (config->min_threads == 0) {
+        config->min_threads = config->threads;
+    }
+    return config->min_n > 0 && config->reps > 0 && config->timeout_s > 0 &&
+           config->threads > 0 && config->min_threads > 0 && config->min_threads <= config->threads;
+}
+
+int main(int argc, char** argv) {
+    struct BenchConfig config = {
+        .json = false,
+        .min_n = 100,
+        .max_n = 10000000,
+        .max_quadratic_n = 10000,
+        .reps = 3,
+        .timeout_s = 60,
+        .seed = 1,
+        .algorithm = NULL,
+        .distribution = -1,
+        .threads = (int)sysconf(_SC_NPROCESSORS_ONLN),
+        .min_threads = 0,
+        .simd_level = simd_detect(),
+    };
+
+    if (!parse_args(argc, argv, &config)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (config.json) {
+        printf("[");
+    } else {
+        printf("algorithm,form,distribution,n,threads,simd,status,seconds,ns_per_element,elements_per_sec,steps,"
+               "steps_per_sec,peak_rss_kb,element,bytes_per_sec\n");
+    }
+
+    bool first = true;
+    for (int a = 0; a < NUM_ALGORITHMS; a++) {
+        const struct BenchAlgorithm* algorithm = &ALGORITHMS[a];
+        if (config.algorithm != NULL && strcmp(config.algorithm, algorithm->name) != 0) {
+            continue;
+        }
+
+        for (int d = 0; d < NUM_DISTRIBUTIONS; d++) {
+            if (config.distribution >= 0 && config.distribution != d) {
+                continue;
+            }
+
+            // sizes go up by powers of ten from min_n to max_n
+            for (long long len = config.min_n; len <= config.max_n; len *= 10) {
+                if (algorithm->quadratic && len > config.max_quadratic_n) {
+                    break;
+                }
+                int max_level = algorithm->simd ? config.simd_level : SIMD_SCALAR;
+                for (int level = SIMD_SCALAR; level <= max_level; level++) {
+                    // the level is inherited by the child process of the case
+                    simd_set_level(level);
+                    const char* simd = algorithm->simd ? simd_level_name(level) : "none";
+                    int threads = algorithm->parallel ? config.min_threads : 1;
+                    int max_threads = algorithm->parallel ? config.threads : 1;
+                    while (true) {
+                        num_threads = threads;
+                        struct BenchResult result = bench_case(algorithm, d, (int)len, &config);
+                        report(&config, algorithm, d, (int)len, threads, simd, &result, first);
+                        first = false;
+                        if (threads >= max_threads) {
+                            break;
+                        }
+                        threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+                    }
+                }
+            }
+        }
+    }
+
+    if (config.json) {
+        printf("\n]\n");
+    }
+    return EXIT_SUCCESS;
+}
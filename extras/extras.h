@@ -0,0 +1,16 @@
+#pragma once
+
+// One-shot reference implementations that the stepwise state machines in
+// src/algorithms.c are modelled after. Each file also has a small demo
+// main() that is left out when compiled with -DEXTRAS_NO_MAIN.
+
+// ================== merge_sort.c ==================
+void merge(int* arr, int left_idx, int mid, int right_idx);
+void merge_sort_recursive(int* arr, int left_idx, int right_idx);
+void merge_sort_iterative_v1(int* arr, int len);
+void merge_sort_iterative_v2(int* arr, int len);
+
+// ================== quick_sort.c ==================
+int partition(int* arr, int left_idx, int right_idx);
+void quick_sort_recursive(int* arr, int left_idx, int right_idx);
+void quick_sort_iterative(int* arr, int len);
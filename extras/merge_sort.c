@@ -1,3 +1,4 @@
+#include "extras.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,8 +7,10 @@
 void merge(int* arr, int left_idx, int mid, int right_idx) {
     int a_len = mid - left_idx + 1;
     int b_len = right_idx - mid;
-    int a[a_len];
-    int b[b_len];
+    // a and b live on the heap, as VLAs they overflow the call stack for
+    // arrays of a few million elements
+    int* a = malloc((a_len + b_len) * sizeof(int));
+    int* b = a + a_len;
 
     // copy elements from arr to a within interval [left, mid]
     for (int i = 0; i < a_len; i++) {
@@ -48,6 +51,8 @@ void merge(int* arr, int left_idx, int mid, int right_idx) {
             b_idx++;
         }
     }
+
+    free(a);
 }
 
 void merge_sort_recursive(int* arr, int left_idx, int right_idx) {
@@ -109,9 +114,9 @@ void merge_sort_iterative_v2(int* arr, int len) {
     // between beforehand and then iterate over the stack and merge
     // each index pair
 
-    // some arbitary size for the stack, enoough for arrays of up to size 2^50
-    // since we ony store log2(len)*2 elements on the stack
-    int stack[100] = {0};
+    // the stack holds every merge of the recursion tree, that is two ints
+    // for each of the len - 1 internal nodes
+    int* stack = malloc(2 * len * sizeof(int));
     int stack_ptr = build_merge_stack(stack, 0, 0, len - 1);
 
     // iterate over the stack and merge each pair of subarrays
@@ -121,8 +126,11 @@ void merge_sort_iterative_v2(int* arr, int len) {
         int mid = left_idx + (right_idx - left_idx) / 2;
         merge(arr, left_idx, mid, right_idx);
     }
+
+    free(stack);
 }
 
+#ifndef EXTRAS_NO_MAIN
 #define ARR_LEN 20
 
 int main() {
@@ -150,3 +158,4 @@ int main() {
     printf("\nSorting took %f seconds", cpu_time_used);
     return 0;
 }
+#endif
@@ -1,4 +1,31 @@
 #include "algorithms.h"
+#include "parallel.h"
+#include "radix.h"
+#include "simd.h"
+#include "small_sort.h"
+#include "timsort.h"
+#include <string.h>
+
+// ================== Write log ==================
+bool write_log_init(struct WriteLog* log, int capacity) {
+    log->indices = malloc(capacity * sizeof(int));
+    log->len = 0;
+    log->capacity = log->indices != NULL ? capacity : 0;
+    log->overflow = false;
+    return log->indices != NULL;
+}
+
+void write_log_free(struct WriteLog* log) {
+    free(log->indices);
+    log->indices = NULL;
+    log->len = 0;
+    log->capacity = 0;
+}
+
+void write_log_clear(struct WriteLog* log) {
+    log->len = 0;
+    log->overflow = false;
+}
 
 // ================== Selection sort ==================
 void selection_sort_init(struct SelectionSortState* state, int arr[], int n) {
@@ -8,11 +35,14 @@ void selection_sort_init(struct SelectionSortState* state, int arr[], int n) {
     state->inner_idx = 0;
     state->min_idx = 0;
     state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
 }
 
 void selection_sort_step(struct SelectionSortState* s) {
     if (s->iter_idx < s->len - 1) {
         if (s->inner_idx < s->len) {
+            s->counters.comparisons++;
             if (s->arr[s->inner_idx] < s->arr[s->min_idx]) {
                 s->min_idx = s->inner_idx;
             }
@@ -21,6 +51,10 @@ void selection_sort_step(struct SelectionSortState* s) {
             int temp = s->arr[s->iter_idx];
             s->arr[s->iter_idx] = s->arr[s->min_idx];
             s->arr[s->min_idx] = temp;
+            s->counters.swaps++;
+            s->counters.writes += 2;
+            log_write(s->write_log, s->iter_idx);
+            log_write(s->write_log, s->min_idx);
             s->iter_idx++;
             s->inner_idx = s->iter_idx + 1;
             s->min_idx = s->iter_idx;
@@ -30,6 +64,33 @@ void selection_sort_step(struct SelectionSortState* s) {
     }
 }
 
+long long selection_sort_step_n(struct SelectionSortState* s, long long n) {
+    long long i = 0;
+    while (i < n && !s->done) {
+        if (s->iter_idx < s->len - 1 && s->inner_idx < s->len) {
+            // run as much of the minimum scan as the batch allows in a
+            // branchless loop, one step per comparison as in the step
+            int end = s->inner_idx + (int)(n - i < s->len - s->inner_idx ? n - i : s->len - s->inner_idx);
+            int min_idx = s->min_idx;
+            int min_value = s->arr[min_idx];
+            for (int j = s->inner_idx; j < end; j++) {
+                int value = s->arr[j];
+                bool less = value < min_value;
+                min_value = less ? value : min_value;
+                min_idx = less ? j : min_idx;
+            }
+            i += end - s->inner_idx;
+            s->counters.comparisons += end - s->inner_idx;
+            s->inner_idx = end;
+            s->min_idx = min_idx;
+        } else {
+            selection_sort_step(s);
+            i++;
+        }
+    }
+    return i;
+}
+
 // ================== Insertion sort ==================
 void insert_sort_init(struct InsertSortState* state, int* arr, int n) {
     // NOTE: order of initialization matters
@@ -37,19 +98,28 @@ void insert_sort_init(struct InsertSortState* state, int* arr, int n) {
     state->iter_idx = 0;
     state->insert_idx = state->iter_idx - 1;
     state->len = n;
-    state->value = state->arr[state->iter_idx];
+    // an empty array has no first element to insert
+    state->value = n > 0 ? state->arr[state->iter_idx] : 0;
     state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
 }
 
 void insert_sort_step(struct InsertSortState* s) {
     if (s->iter_idx < s->len) {
+        s->counters.comparisons += s->insert_idx >= 0;
+        s->counters.writes++;
         if (s->insert_idx >= 0 && s->arr[s->insert_idx] > s->value) {
             s->arr[s->insert_idx + 1] = s->arr[s->insert_idx];
+            log_write(s->write_log, s->insert_idx + 1);
             s->insert_idx--;
         } else {
             s->arr[s->insert_idx + 1] = s->value;
+            log_write(s->write_log, s->insert_idx + 1);
             s->iter_idx++;
-            s->value = s->arr[s->iter_idx];
+            if (s->iter_idx < s->len) {
+                s->value = s->arr[s->iter_idx];
+            }
             s->insert_idx = s->iter_idx - 1;
         }
 
@@ -58,61 +128,178 @@ void insert_sort_step(struct InsertSortState* s) {
     }
 }
 
-// ================== Merge sort ==================
-static int build_merge_stack(int* stack, int stack_ptr, int left_idx, int right_idx) {
-    if (left_idx >= right_idx) {
-        return stack_ptr;
+long long insert_sort_step_n(struct InsertSortState* s, long long n) {
+    long long i = 0;
+    while (i < n && !s->done) {
+        if (s->iter_idx < s->len) {
+            // the shifts of the current element only need the inner
+            // condition, insert_sort_step is left for placing it
+            int from = s->insert_idx;
+            while (i < n && s->insert_idx >= 0 && s->arr[s->insert_idx] > s->value) {
+                s->arr[s->insert_idx + 1] = s->arr[s->insert_idx];
+                log_write(s->write_log, s->insert_idx + 1);
+                s->insert_idx--;
+                i++;
+            }
+            // a comparison and a write per shift, the comparison that ends
+            // the loop is counted by insert_sort_step
+            s->counters.comparisons += from - s->insert_idx;
+            s->counters.writes += from - s->insert_idx;
+            if (i == n) {
+                break;
+            }
+        }
+        insert_sort_step(s);
+        i++;
     }
+    return i;
+}
 
-    stack[stack_ptr++] = left_idx;
-    stack[stack_ptr++] = right_idx;
+// ================== Binary insertion sort ==================
+static void binary_insert_begin(struct BinaryInsertSortState* state) {
+    if (state->iter_idx >= state->len) {
+        state->done = true;
+        return;
+    }
+    state->value = state->arr[state->iter_idx];
+    state->lo = 0;
+    state->hi = state->iter_idx;
+}
 
-    int mid = left_idx + (right_idx - left_idx) / 2;
-    stack_ptr = build_merge_stack(stack, stack_ptr, mid + 1, right_idx);
-    return build_merge_stack(stack, stack_ptr, left_idx, mid);
+void binary_insert_sort_init(struct BinaryInsertSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->iter_idx = 1;
+    state->lo = 0;
+    state->hi = 0;
+    state->value = 0;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+    binary_insert_begin(state);
+}
+
+void binary_insert_sort_step(struct BinaryInsertSortState* state) {
+    if (state->lo < state->hi) {
+        // the slot is after every element equal to value, which keeps the
+        // sort stable
+        int mid = state->lo + (state->hi - state->lo) / 2;
+        state->counters.comparisons++;
+        if (state->arr[mid] > state->value) {
+            state->hi = mid;
+        } else {
+            state->lo = mid + 1;
+        }
+        return;
+    }
+
+    // the whole block behind the slot moves in a single step
+    int slot = state->lo;
+    int* arr = state->arr;
+    memmove(arr + slot + 1, arr + slot, (state->iter_idx - slot) * sizeof(int));
+    arr[slot] = state->value;
+    state->counters.writes += state->iter_idx - slot + 1;
+    for (int k = slot; k <= state->iter_idx; k++) {
+        log_write(state->write_log, k);
+    }
+    state->iter_idx++;
+    binary_insert_begin(state);
 }
 
-static void merge_init(struct MergeSortState* state, bool should_realloc) {
+long long binary_insert_sort_step_n(struct BinaryInsertSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        binary_insert_sort_step(state);
+    }
+    return i;
+}
+
+// ================== Merge sort ==================
+static void push_merge_frame(struct MergeSortState* state, int left_idx, int right_idx) {
+    struct MergeFrame* frame = &state->stack[state->stack_ptr++];
+    frame->left_idx = left_idx;
+    frame->right_idx = right_idx;
+    frame->expanded = false;
+}
+
+// find the next subarray to merge, visiting the recursion tree in post-order
+// (left half, right half, then the subarray itself), returns false when the
+// whole array has been merged
+static bool next_merge(struct MergeSortState* state) {
+    while (state->stack_ptr > 0) {
+        struct MergeFrame* top = &state->stack[state->stack_ptr - 1];
+        if (top->expanded) {
+            // both halves are sorted, merge them
+            state->merge_left_idx = top->left_idx;
+            state->merge_right_idx = top->right_idx;
+            state->stack_ptr--;
+            return true;
+        }
+
+        // push the right half first so that the left half is merged first,
+        // subarrays of a single element are already sorted
+        top->expanded = true;
+        int left_idx = top->left_idx;
+        int right_idx = top->right_idx;
+        int mid = left_idx + (right_idx - left_idx) / 2;
+        if (mid + 1 < right_idx) {
+            push_merge_frame(state, mid + 1, right_idx);
+        }
+        if (left_idx < mid) {
+            push_merge_frame(state, left_idx, mid);
+        }
+    }
+    return false;
+}
+
+static void merge_init(struct MergeSortState* state) {
     // reset merge step state to initial values
     state->merge_done = false;
     state->subarr_left_idx = 0;
     state->subarr_right_idx = 0;
     state->merge_iter = 0;
 
-    // reallocate subarr_left and subarr_right to fit the new
-    // subarray sizes and copy elements from arr
+    // copy elements from arr to scratch within interval [left_idx, mid],
+    // the right half (mid, right_idx] is merged directly from arr since the
+    // write position can never pass the next unread element of it
     int mid = state->merge_left_idx + (state->merge_right_idx - state->merge_left_idx) / 2;
-    int left_len = mid - state->merge_left_idx + 1;
-    int right_len = state->merge_right_idx - mid;
-    if (should_realloc) {
-        state->subarr_left = realloc(state->subarr_left, left_len * sizeof(int));
-        state->subarr_right = realloc(state->subarr_right, right_len * sizeof(int));
-    } else {
-        state->subarr_left = malloc(left_len * sizeof(int));
-        state->subarr_right = malloc(right_len * sizeof(int));
-    }
-
-    // copy elements from arr to left within interval [left_idx, mid]
-    for (int i = 0; i < left_len; i++) {
-        state->subarr_left[i] = state->arr[state->merge_left_idx + i];
-    }
-
-    // copy elements from arr to right within interval (mid, right_idx]
-    for (int i = 0; i < right_len; i++) {
-        state->subarr_right[i] = state->arr[mid + i + 1];
+    for (int i = state->merge_left_idx; i <= mid; i++) {
+        state->scratch[i] = state->arr[i];
     }
+    state->counters.writes += mid - state->merge_left_idx + 1;
 }
 
 void merge_sort_init(struct MergeSortState* state, int* arr, int len) {
     state->arr = arr;
     state->len = len;
-    state->done = false;
-    state->stack = malloc(1000 * sizeof(int)); // somewhat arbitrary size
-    state->stack_ptr = build_merge_stack(state->stack, 0, 0, len - 1);
+    state->stack_ptr = 0;
+    state->counters = (struct Counters){0};
+    state->scratch = malloc(len * sizeof(int));
+    count_allocation(&state->counters, state->scratch, len * sizeof(int));
     state->merge_left_idx = 0;
     state->merge_right_idx = len - 1;
+    state->subarr_left_idx = 0;
+    state->subarr_right_idx = 0;
+    state->merge_iter = 0;
+    state->write_log = NULL;
+    // nothing can be merged without the scratch buffer
+    state->done = len > 1 && state->scratch == NULL;
 
-    merge_init(state, false);
+    if (len > 1 && !state->done) {
+        push_merge_frame(state, 0, len - 1);
+    }
+    if (next_merge(state)) {
+        merge_init(state);
+    } else {
+        // nothing to merge for arrays with less than two elements
+        state->merge_done = true;
+    }
+}
+
+void merge_sort_free(struct MergeSortState* state) {
+    count_free(&state->counters, state->scratch, state->len * sizeof(int));
+    free(state->scratch);
+    state->scratch = NULL;
 }
 
 static void merge_step(struct MergeSortState* state) {
@@ -121,17 +308,21 @@ static void merge_step(struct MergeSortState* state) {
     int hi = state->merge_right_idx;
     int mid = lo + (hi - lo) / 2;
 
-    int* a = state->subarr_left;
-    int* b = state->subarr_right;
+    int* a = state->scratch + lo;
+    int* b = state->arr + mid + 1;
     int a_len = mid - lo + 1;
     int b_len = hi - mid;
     int a_idx = state->subarr_left_idx;
     int b_idx = state->subarr_right_idx;
 
-    // NOTE: a is subarr_left, b is subarr_right
+    // NOTE: a is the left half copied to scratch, b is the right half in arr
     // loop until we have traversed all elements in
     // subarr_left and subarr_right
     if (state->merge_iter < a_len + b_len) {
+        // every branch below writes to the same position
+        log_write(state->write_log, lo + state->merge_iter);
+        state->counters.writes++;
+
         // if we have traversed all elements in subarr_left,
         // then add the remaining elements from subarr_right
         if (a_idx >= a_len) {
@@ -153,6 +344,7 @@ static void merge_step(struct MergeSortState* state) {
         // if element in subarr_left is less than or equal to element
         // in subarr_right, then add element in subarr_left to arr and
         // move to next element in subarr_left
+        state->counters.comparisons++;
         if (a[a_idx] <= b[b_idx]) {
             state->arr[lo + state->merge_iter] = a[a_idx];
             state->subarr_left_idx++;
@@ -168,18 +360,894 @@ static void merge_step(struct MergeSortState* state) {
 }
 
 void merge_sort_step(struct MergeSortState* state) {
-    // analagous to merge_sort_iterative_v2 in the extras directory,
-    // reference that version for better understanding of the algorithm,
-    // this is a cluterfuck
+    // merges in the same order as merge_sort_recursive in the extras
+    // directory, but one element at a time and with the recursion unrolled
+    // into next_merge, reference that version for better understanding
     if (!state->merge_done) {
         merge_step(state);
-    } else if (state->stack_ptr > 1) {
-        // pop the next pair of subarrays to merge from the stack
-        state->merge_right_idx = state->stack[--state->stack_ptr];
-        state->merge_left_idx = state->stack[--state->stack_ptr];
+    } else if (next_merge(state)) {
         // reset merge step state to initial values
-        merge_init(state, true);
+        merge_init(state);
+    } else {
+        state->done = true;
+    }
+}
+
+long long merge_sort_step_n(struct MergeSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        merge_sort_step(state);
+    }
+    return i;
+}
+
+// comparisons merge_step makes to merge a and b, one per element taken while
+// neither run is exhausted
+static long long merge_comparisons(const int* a, int a_len, const int* b, int b_len) {
+    if (a_len == 0 || b_len == 0) {
+        return 0;
+    }
+    // ties are taken from a, so a runs out first if its last element is not
+    // greater than the last of b, after the elements of b less than it
+    if (a[a_len - 1] <= b[b_len - 1]) {
+        return a_len + lower_bound(b, b_len, a[a_len - 1]);
+    }
+    return b_len + upper_bound(a, a_len, b[b_len - 1]);
+}
+
+long long merge_sort_step_n_fast(struct MergeSortState* state, long long n) {
+    long long i = 0;
+    while (i < n && !state->done) {
+        int lo = state->merge_left_idx;
+        int hi = state->merge_right_idx;
+        int mid = lo + (hi - lo) / 2;
+        int a_len = mid - lo + 1;
+        int b_len = hi - mid;
+        int remaining = a_len + b_len - state->merge_iter;
+        if (state->merge_done || remaining == 0 || n - i < remaining) {
+            merge_sort_step(state);
+            i++;
+            continue;
+        }
+
+        // the batch covers the rest of the current merge, which is one step
+        // per element, so finish it with the vectorized merge in one go
+        int a_idx = state->subarr_left_idx;
+        int b_idx = state->subarr_right_idx;
+        int out_idx = lo + state->merge_iter;
+        state->counters.comparisons +=
+            merge_comparisons(state->scratch + lo + a_idx, a_len - a_idx, state->arr + mid + 1 + b_idx, b_len - b_idx);
+        state->counters.writes += remaining;
+        simd_merge(state->scratch + lo + a_idx, a_len - a_idx, state->arr + mid + 1 + b_idx, b_len - b_idx,
+                   state->arr + out_idx);
+        if (state->write_log != NULL) {
+            for (int k = out_idx; k <= hi; k++) {
+                log_write(state->write_log, k);
+            }
+        }
+        state->subarr_left_idx = a_len;
+        state->subarr_right_idx = b_len;
+        state->merge_iter = a_len + b_len;
+        i += remaining;
+    }
+    return i;
+}
+
+// ================== Quick sort ==================
+static inline void swap_logged(struct QuickSortState* state, int a, int b) {
+    int temp = state->arr[a];
+    state->arr[a] = state->arr[b];
+    state->arr[b] = temp;
+    state->counters.swaps++;
+    state->counters.writes += 2;
+    log_write(state->write_log, a);
+    log_write(state->write_log, b);
+}
+
+static void push_range(struct QuickSortState* state, int left_idx, int right_idx) {
+    // ranges with less than two elements are already sorted
+    if (left_idx < right_idx) {
+        state->stack[state->stack_ptr++] = (struct QuickSortRange){left_idx, right_idx};
+    }
+}
+
+// index of the median of arr[a], arr[b] and arr[c], adds the comparisons it
+// makes to comparisons
+static int median_of_three(const int* arr, int a, int b, int c, int* comparisons) {
+    if (arr[a] < arr[b]) {
+        if (arr[b] < arr[c]) {
+            *comparisons += 2;
+            return b;
+        }
+        *comparisons += 3;
+        return arr[a] < arr[c] ? c : a;
+    }
+    if (arr[a] < arr[c]) {
+        *comparisons += 2;
+        return a;
+    }
+    *comparisons += 3;
+    return arr[b] < arr[c] ? c : b;
+}
+
+int quick_sort_pivot(const int* arr, int left_idx, int right_idx, long long* comparisons) {
+    int len = right_idx - left_idx + 1;
+    int mid = left_idx + len / 2;
+    int made = 0;
+    int pivot;
+    if (len <= QUICK_SORT_NINTHER_THRESHOLD) {
+        pivot = median_of_three(arr, left_idx, mid, right_idx, &made);
     } else {
+        // sample nine elements spread over the range, sorted and reversed
+        // input give a pivot close to the true median
+        int step = len / 8;
+        int a = median_of_three(arr, left_idx, left_idx + step, left_idx + 2 * step, &made);
+        int b = median_of_three(arr, mid - step, mid, mid + step, &made);
+        int c = median_of_three(arr, right_idx - 2 * step, right_idx - step, right_idx, &made);
+        pivot = median_of_three(arr, a, b, c, &made);
+    }
+    if (comparisons != NULL) {
+        *comparisons += made;
+    }
+    return pivot;
+}
+
+static void insertion_init(struct QuickSortState* state) {
+    state->iter_idx = state->left_idx + 1;
+    state->insert_idx = state->left_idx;
+    state->value = state->arr[state->iter_idx];
+}
+
+static void next_range(struct QuickSortState* state) {
+    if (state->stack_ptr == 0) {
         state->done = true;
+        return;
+    }
+    struct QuickSortRange range = state->stack[--state->stack_ptr];
+    state->left_idx = range.left_idx;
+    state->right_idx = range.right_idx;
+
+    if (range.right_idx - range.left_idx + 1 <= QUICK_SORT_CUTOFF) {
+        state->phase = QUICK_SORT_INSERTION;
+        insertion_init(state);
+        return;
+    }
+    state->phase = QUICK_SORT_PARTITION;
+    state->pivot =
+        state->arr[quick_sort_pivot(state->arr, range.left_idx, range.right_idx, &state->counters.comparisons)];
+    state->lt_idx = range.left_idx;
+    state->iter_idx = range.left_idx;
+    state->gt_idx = range.right_idx;
+}
+
+void quick_sort_init(struct QuickSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->stack_ptr = 0;
+    state->phase = QUICK_SORT_NEXT_RANGE;
+    state->left_idx = 0;
+    state->right_idx = len - 1;
+    state->pivot = 0;
+    state->lt_idx = 0;
+    state->iter_idx = 0;
+    state->gt_idx = len - 1;
+    state->insert_idx = 0;
+    state->value = 0;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+
+    push_range(state, 0, len - 1);
+}
+
+static void partition_step(struct QuickSortState* state) {
+    if (state->iter_idx <= state->gt_idx) {
+        // one comparison against the pivot per step, equal elements stay in
+        // the middle so runs of duplicates are never partitioned again
+        int value = state->arr[state->iter_idx];
+        state->counters.comparisons += value < state->pivot ? 1 : 2;
+        if (value < state->pivot) {
+            swap_logged(state, state->lt_idx++, state->iter_idx++);
+        } else if (value > state->pivot) {
+            swap_logged(state, state->iter_idx, state->gt_idx--);
+        } else {
+            state->iter_idx++;
+        }
+        return;
+    }
+
+    // the larger partition is pushed first so that the smaller one is on top
+    int left_len = state->lt_idx - state->left_idx;
+    int right_len = state->right_idx - state->gt_idx;
+    if (left_len > right_len) {
+        push_range(state, state->left_idx, state->lt_idx - 1);
+        push_range(state, state->gt_idx + 1, state->right_idx);
+    } else {
+        push_range(state, state->gt_idx + 1, state->right_idx);
+        push_range(state, state->left_idx, state->lt_idx - 1);
+    }
+    state->phase = QUICK_SORT_NEXT_RANGE;
+}
+
+static void insertion_step(struct QuickSortState* state) {
+    state->counters.comparisons += state->insert_idx >= state->left_idx;
+    state->counters.writes++;
+    if (state->insert_idx >= state->left_idx && state->arr[state->insert_idx] > state->value) {
+        state->arr[state->insert_idx + 1] = state->arr[state->insert_idx];
+        log_write(state->write_log, state->insert_idx + 1);
+        state->insert_idx--;
+        return;
+    }
+
+    state->arr[state->insert_idx + 1] = state->value;
+    log_write(state->write_log, state->insert_idx + 1);
+    state->iter_idx++;
+    if (state->iter_idx > state->right_idx) {
+        state->phase = QUICK_SORT_NEXT_RANGE;
+        return;
+    }
+    state->value = state->arr[state->iter_idx];
+    state->insert_idx = state->iter_idx - 1;
+}
+
+void quick_sort_step(struct QuickSortState* state) {
+    switch (state->phase) {
+    case QUICK_SORT_NEXT_RANGE:
+        next_range(state);
+        break;
+    case QUICK_SORT_PARTITION:
+        partition_step(state);
+        break;
+    case QUICK_SORT_INSERTION:
+        insertion_step(state);
+        break;
+    }
+}
+
+long long quick_sort_step_n(struct QuickSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        quick_sort_step(state);
+    }
+    return i;
+}
+
+// ================== Bubble sort ==================
+void bubble_sort_init(struct BubbleSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->iter_idx = 0;
+    state->inner_idx = 0;
+    state->swapped = false;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+}
+
+void bubble_sort_step(struct BubbleSortState* state) {
+    // the last iter_idx elements are already in place
+    int end = state->len - 1 - state->iter_idx;
+    if (state->inner_idx < end) {
+        int i = state->inner_idx;
+        state->counters.comparisons++;
+        if (state->arr[i] > state->arr[i + 1]) {
+            int temp = state->arr[i];
+            state->arr[i] = state->arr[i + 1];
+            state->arr[i + 1] = temp;
+            state->counters.swaps++;
+            state->counters.writes += 2;
+            log_write(state->write_log, i);
+            log_write(state->write_log, i + 1);
+            state->swapped = true;
+        }
+        state->inner_idx++;
+    } else if (state->swapped) {
+        // start the next pass
+        state->iter_idx++;
+        state->inner_idx = 0;
+        state->swapped = false;
+    } else {
+        // a pass without swaps means the array is sorted
+        state->done = true;
+    }
+}
+
+long long bubble_sort_step_n(struct BubbleSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        bubble_sort_step(state);
+    }
+    return i;
+}
+
+// ================== Intro sort ==================
+static inline void intro_swap(struct IntroSortState* state, int a, int b) {
+    int temp = state->arr[a];
+    state->arr[a] = state->arr[b];
+    state->arr[b] = temp;
+    state->counters.swaps++;
+    state->counters.writes += 2;
+    log_write(state->write_log, a);
+    log_write(state->write_log, b);
+}
+
+static void push_intro_range(struct IntroSortState* state, int left_idx, int right_idx, int bad_allowed) {
+    if (left_idx < right_idx) {
+        state->stack[state->stack_ptr++] = (struct IntroSortRange){left_idx, right_idx, bad_allowed};
+    }
+}
+
+static int floor_log2(int n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
+    }
+    return log;
+}
+
+static void intro_next_range(struct IntroSortState* state) {
+    if (state->stack_ptr == 0) {
+        state->done = true;
+        return;
+    }
+    struct IntroSortRange range = state->stack[--state->stack_ptr];
+    int left_idx = range.left_idx;
+    int right_idx = range.right_idx;
+    state->left_idx = left_idx;
+    state->right_idx = right_idx;
+    state->bad_allowed = range.bad_allowed;
+
+    int len = right_idx - left_idx + 1;
+    if (len <= INTRO_SORT_CUTOFF) {
+        state->phase = INTRO_SORT_INSERTION;
+        state->i_idx = left_idx + 1;
+        state->insert_idx = left_idx;
+        state->value = state->arr[left_idx + 1];
+        return;
+    }
+    if (range.bad_allowed == 0) {
+        state->phase = INTRO_SORT_HEAPSORT;
+        state->heap_len = len;
+        state->heap_start = len / 2 - 1;
+        state->sift_idx = -1;
+        return;
+    }
+
+    // move the pivot out of the way to the front of the range
+    intro_swap(state, left_idx, quick_sort_pivot(state->arr, left_idx, right_idx, &state->counters.comparisons));
+    state->phase = INTRO_SORT_PARTITION;
+    state->pivot = state->arr[left_idx];
+    state->i_idx = left_idx + 1;
+    state->j_idx = right_idx;
+    // everything before the range is less than or equal to all of it
+    state->counters.comparisons += left_idx > 0;
+    state->partition_left = left_idx > 0 && state->arr[left_idx - 1] == state->pivot;
+}
+
+void intro_sort_init(struct IntroSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->stack_ptr = 0;
+    state->phase = INTRO_SORT_NEXT_RANGE;
+    state->left_idx = 0;
+    state->right_idx = len - 1;
+    state->bad_allowed = 0;
+    state->pivot = 0;
+    state->i_idx = 0;
+    state->j_idx = len - 1;
+    state->partition_left = false;
+    state->insert_idx = 0;
+    state->value = 0;
+    state->heap_len = 0;
+    state->heap_start = -1;
+    state->sift_idx = -1;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+
+    push_intro_range(state, 0, len - 1, floor_log2(len));
+}
+
+static void intro_partition_done(struct IntroSortState* state) {
+    // put the pivot between the two sides
+    int pivot_idx = state->j_idx;
+    intro_swap(state, state->left_idx, pivot_idx);
+    state->phase = INTRO_SORT_NEXT_RANGE;
+
+    if (state->partition_left) {
+        // the left side only holds copies of the pivot and is sorted
+        push_intro_range(state, pivot_idx + 1, state->right_idx, state->bad_allowed);
+        return;
+    }
+
+    int left_len = pivot_idx - state->left_idx;
+    int right_len = state->right_idx - pivot_idx;
+    int len = state->right_idx - state->left_idx + 1;
+    int bad_allowed = state->bad_allowed;
+    if (left_len < len / 8 || right_len < len / 8) {
+        bad_allowed--;
+    }
+    // smaller side on top of the stack
+    if (left_len > right_len) {
+        push_intro_range(state, state->left_idx, pivot_idx - 1, bad_allowed);
+        push_intro_range(state, pivot_idx + 1, state->right_idx, bad_allowed);
+    } else {
+        push_intro_range(state, pivot_idx + 1, state->right_idx, bad_allowed);
+        push_intro_range(state, state->left_idx, pivot_idx - 1, bad_allowed);
+    }
+}
+
+static void intro_partition_step(struct IntroSortState* state) {
+    int* arr = state->arr;
+    int i = state->i_idx;
+    int j = state->j_idx;
+    // partition_left sends elements equal to the pivot left, otherwise right,
+    // i can be one past the range once the sides have met
+    if (i <= j && (state->partition_left ? arr[i] <= state->pivot : arr[i] < state->pivot)) {
+        state->counters.comparisons++;
+        state->i_idx++;
+    } else if (i <= j && (state->partition_left ? arr[j] > state->pivot : arr[j] >= state->pivot)) {
+        state->counters.comparisons += 2;
+        state->j_idx--;
+    } else if (i < j) {
+        // both are on the wrong side
+        state->counters.comparisons += 2;
+        intro_swap(state, i, j);
+        state->i_idx++;
+        state->j_idx--;
+    } else {
+        state->counters.comparisons += i <= j ? 2 : 0;
+        intro_partition_done(state);
+    }
+}
+
+static void intro_insertion_step(struct IntroSortState* state) {
+    state->counters.comparisons += state->insert_idx >= state->left_idx;
+    state->counters.writes++;
+    if (state->insert_idx >= state->left_idx && state->arr[state->insert_idx] > state->value) {
+        state->arr[state->insert_idx + 1] = state->arr[state->insert_idx];
+        log_write(state->write_log, state->insert_idx + 1);
+        state->insert_idx--;
+        return;
+    }
+
+    state->arr[state->insert_idx + 1] = state->value;
+    log_write(state->write_log, state->insert_idx + 1);
+    state->i_idx++;
+    if (state->i_idx > state->right_idx) {
+        state->phase = INTRO_SORT_NEXT_RANGE;
+        return;
+    }
+    state->value = state->arr[state->i_idx];
+    state->insert_idx = state->i_idx - 1;
+}
+
+static void intro_heapsort_step(struct IntroSortState* state) {
+    int* heap = state->arr + state->left_idx;
+    if (state->sift_idx >= 0) {
+        // one level of sift down per step
+        int node = state->sift_idx;
+        int child = 2 * node + 1;
+        if (child >= state->heap_len) {
+            state->sift_idx = -1;
+            return;
+        }
+        state->counters.comparisons += child + 1 < state->heap_len ? 2 : 1;
+        if (child + 1 < state->heap_len && heap[child + 1] > heap[child]) {
+            child++;
+        }
+        if (heap[child] > heap[node]) {
+            intro_swap(state, state->left_idx + node, state->left_idx + child);
+            state->sift_idx = child;
+        } else {
+            state->sift_idx = -1;
+        }
+    } else if (state->heap_start >= 0) {
+        // still building the heap from the last parent up to the root
+        state->sift_idx = state->heap_start--;
+    } else if (state->heap_len > 1) {
+        // move the maximum behind the heap and restore the heap property
+        state->heap_len--;
+        intro_swap(state, state->left_idx, state->left_idx + state->heap_len);
+        state->sift_idx = 0;
+    } else {
+        state->phase = INTRO_SORT_NEXT_RANGE;
+    }
+}
+
+void intro_sort_step(struct IntroSortState* state) {
+    switch (state->phase) {
+    case INTRO_SORT_NEXT_RANGE:
+        intro_next_range(state);
+        break;
+    case INTRO_SORT_PARTITION:
+        intro_partition_step(state);
+        break;
+    case INTRO_SORT_INSERTION:
+        intro_insertion_step(state);
+        break;
+    case INTRO_SORT_HEAPSORT:
+        intro_heapsort_step(state);
+        break;
+    }
+}
+
+long long intro_sort_step_n(struct IntroSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        intro_sort_step(state);
+    }
+    return i;
+}
+
+// ================== Registry ==================
+// adapters from the untyped Algorithm interface to the functions above
+
+static void selection_init(void* state, int* arr, int len) { selection_sort_init(state, arr, len); }
+static void selection_step(void* state) { selection_sort_step(state); }
+static long long selection_step_n(void* state, long long n) { return selection_sort_step_n(state, n); }
+static bool selection_done(const void* state) { return ((const struct SelectionSortState*)state)->done; }
+static void selection_set_write_log(void* state, struct WriteLog* log) { ((struct SelectionSortState*)state)->write_log = log; }
+static const struct Counters* selection_counters(const void* state) { return &((const struct SelectionSortState*)state)->counters; }
+
+static int selection_highlights(const void* state, struct Highlight* out) {
+    const struct SelectionSortState* s = state;
+    out[0] = (struct Highlight){s->iter_idx, HIGHLIGHT_PRIMARY, 0};
+    out[1] = (struct Highlight){s->inner_idx, HIGHLIGHT_SECONDARY, 0};
+    out[2] = (struct Highlight){s->min_idx, HIGHLIGHT_TERTIARY, 0};
+    return 3;
+}
+
+static void insert_init(void* state, int* arr, int len) { insert_sort_init(state, arr, len); }
+static void insert_step(void* state) { insert_sort_step(state); }
+static long long insert_step_n(void* state, long long n) { return insert_sort_step_n(state, n); }
+static bool insert_done(const void* state) { return ((const struct InsertSortState*)state)->done; }
+static void insert_set_write_log(void* state, struct WriteLog* log) { ((struct InsertSortState*)state)->write_log = log; }
+static const struct Counters* insert_counters(const void* state) { return &((const struct InsertSortState*)state)->counters; }
+
+static int insert_highlights(const void* state, struct Highlight* out) {
+    const struct InsertSortState* s = state;
+    out[0] = (struct Highlight){s->iter_idx + 1, HIGHLIGHT_PRIMARY, 0};
+    out[1] = (struct Highlight){s->insert_idx, HIGHLIGHT_SECONDARY, 0};
+    return 2;
+}
+
+static void merge_init_state(void* state, int* arr, int len) { merge_sort_init(state, arr, len); }
+static void merge_step_state(void* state) { merge_sort_step(state); }
+static long long merge_step_n(void* state, long long n) { return merge_sort_step_n(state, n); }
+static bool merge_done(const void* state) { return ((const struct MergeSortState*)state)->done; }
+static void merge_free(void* state) { merge_sort_free(state); }
+static long long merge_step_n_fast(void* state, long long n) { return merge_sort_step_n_fast(state, n); }
+static void merge_set_write_log(void* state, struct WriteLog* log) { ((struct MergeSortState*)state)->write_log = log; }
+static const struct Counters* merge_counters(const void* state) { return &((const struct MergeSortState*)state)->counters; }
+
+static int merge_highlights(const void* state, struct Highlight* out) {
+    const struct MergeSortState* s = state;
+    int left_idx = s->merge_left_idx;
+    int right_idx = s->merge_right_idx;
+    int mid = left_idx + (right_idx - left_idx) / 2;
+    out[0] = (struct Highlight){left_idx + s->subarr_left_idx, HIGHLIGHT_SECONDARY, 0};
+    out[1] = (struct Highlight){mid + s->subarr_right_idx + 1, HIGHLIGHT_SECONDARY, 0};
+    out[2] = (struct Highlight){left_idx + s->merge_iter, HIGHLIGHT_TERTIARY, 0};
+    out[3] = (struct Highlight){left_idx, HIGHLIGHT_PRIMARY, 0};
+    out[4] = (struct Highlight){right_idx, HIGHLIGHT_PRIMARY, 0};
+    return 5;
+}
+
+static void quick_init(void* state, int* arr, int len) { quick_sort_init(state, arr, len); }
+static void quick_step(void* state) { quick_sort_step(state); }
+static long long quick_step_n(void* state, long long n) { return quick_sort_step_n(state, n); }
+static bool quick_done(const void* state) { return ((const struct QuickSortState*)state)->done; }
+static void quick_set_write_log(void* state, struct WriteLog* log) { ((struct QuickSortState*)state)->write_log = log; }
+static const struct Counters* quick_counters(const void* state) { return &((const struct QuickSortState*)state)->counters; }
+
+static int quick_highlights(const void* state, struct Highlight* out) {
+    const struct QuickSortState* s = state;
+    int n = 0;
+    out[n++] = (struct Highlight){s->left_idx, HIGHLIGHT_PRIMARY, 0};
+    out[n++] = (struct Highlight){s->right_idx, HIGHLIGHT_PRIMARY, 0};
+    if (s->phase == QUICK_SORT_PARTITION) {
+        out[n++] = (struct Highlight){s->lt_idx, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->gt_idx, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_TERTIARY, 0};
+    } else if (s->phase == QUICK_SORT_INSERTION) {
+        out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_TERTIARY, 0};
+        out[n++] = (struct Highlight){s->insert_idx, HIGHLIGHT_SECONDARY, 0};
+    }
+    return n;
+}
+
+static void bubble_init(void* state, int* arr, int len) { bubble_sort_init(state, arr, len); }
+static void bubble_step(void* state) { bubble_sort_step(state); }
+static long long bubble_step_n(void* state, long long n) { return bubble_sort_step_n(state, n); }
+static bool bubble_done(const void* state) { return ((const struct BubbleSortState*)state)->done; }
+static void bubble_set_write_log(void* state, struct WriteLog* log) { ((struct BubbleSortState*)state)->write_log = log; }
+static const struct Counters* bubble_counters(const void* state) { return &((const struct BubbleSortState*)state)->counters; }
+
+static int bubble_highlights(const void* state, struct Highlight* out) {
+    const struct BubbleSortState* s = state;
+    out[0] = (struct Highlight){s->inner_idx, HIGHLIGHT_SECONDARY, 0};
+    out[1] = (struct Highlight){s->inner_idx + 1, HIGHLIGHT_SECONDARY, 0};
+    out[2] = (struct Highlight){s->len - 1 - s->iter_idx, HIGHLIGHT_PRIMARY, 0};
+    return 3;
+}
+
+static void intro_init(void* state, int* arr, int len) { intro_sort_init(state, arr, len); }
+static void intro_step(void* state) { intro_sort_step(state); }
+static long long intro_step_n(void* state, long long n) { return intro_sort_step_n(state, n); }
+static bool intro_done(const void* state) { return ((const struct IntroSortState*)state)->done; }
+static void intro_set_write_log(void* state, struct WriteLog* log) { ((struct IntroSortState*)state)->write_log = log; }
+static const struct Counters* intro_counters(const void* state) { return &((const struct IntroSortState*)state)->counters; }
+
+static int intro_highlights(const void* state, struct Highlight* out) {
+    const struct IntroSortState* s = state;
+    int n = 0;
+    out[n++] = (struct Highlight){s->left_idx, HIGHLIGHT_PRIMARY, 0};
+    out[n++] = (struct Highlight){s->right_idx, HIGHLIGHT_PRIMARY, 0};
+    switch (s->phase) {
+    case INTRO_SORT_PARTITION:
+        out[n++] = (struct Highlight){s->i_idx, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->j_idx, HIGHLIGHT_SECONDARY, 0};
+        break;
+    case INTRO_SORT_INSERTION:
+        out[n++] = (struct Highlight){s->i_idx, HIGHLIGHT_TERTIARY, 0};
+        out[n++] = (struct Highlight){s->insert_idx, HIGHLIGHT_SECONDARY, 0};
+        break;
+    case INTRO_SORT_HEAPSORT:
+        out[n++] = (struct Highlight){s->left_idx + s->heap_len - 1, HIGHLIGHT_TERTIARY, 0};
+        if (s->sift_idx >= 0) {
+            out[n++] = (struct Highlight){s->left_idx + s->sift_idx, HIGHLIGHT_SECONDARY, 0};
+        }
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
+static void parallel_init(void* state, int* arr, int len) { parallel_merge_sort_init(state, arr, len); }
+static void parallel_step(void* state) { parallel_merge_sort_step(state); }
+static long long parallel_step_n(void* state, long long n) { return parallel_merge_sort_step_n(state, n); }
+static bool parallel_done(const void* state) { return ((const struct ParallelMergeSortState*)state)->done; }
+static void parallel_free(void* state) { parallel_merge_sort_free(state); }
+static void parallel_set_write_log(void* state, struct WriteLog* log) { ((struct ParallelMergeSortState*)state)->write_log = log; }
+static const struct Counters* parallel_counters(const void* state) { return &((const struct ParallelMergeSortState*)state)->counters; }
+
+static int parallel_highlights(const void* state, struct Highlight* out) {
+    const struct ParallelMergeSortState* s = state;
+    int n = 0;
+    if (s->level_done) {
+        return 0;
+    }
+    // the merge window and write position of every worker that is not done
+    for (int t = 0; t < PARALLEL_STEP_WORKERS; t++) {
+        const struct MergeWorker* w = &s->workers[t];
+        if (w->out_idx < w->out_end) {
+            out[n++] = (struct Highlight){w->out_idx, HIGHLIGHT_WORKER, t};
+            out[n++] = (struct Highlight){w->merge_left_idx, HIGHLIGHT_WORKER, t};
+            out[n++] = (struct Highlight){w->merge_right_idx, HIGHLIGHT_WORKER, t};
+        }
+    }
+    return n;
+}
+
+static void parallel_quick_init(void* state, int* arr, int len) { parallel_quick_sort_init(state, arr, len); }
+static void parallel_quick_step(void* state) { parallel_quick_sort_step(state); }
+static long long parallel_quick_step_n(void* state, long long n) { return parallel_quick_sort_step_n(state, n); }
+static bool parallel_quick_done(const void* state) { return ((const struct ParallelQuickSortState*)state)->done; }
+static void parallel_quick_set_write_log(void* state, struct WriteLog* log) { ((struct ParallelQuickSortState*)state)->write_log = log; }
+static const struct Counters* parallel_quick_counters(const void* state) { return &((const struct ParallelQuickSortState*)state)->counters; }
+
+static int parallel_quick_highlights(const void* state, struct Highlight* out) {
+    const struct ParallelQuickSortState* s = state;
+    int n = 0;
+    // the range each busy worker is partitioning and its scan position
+    for (int t = 0; t < PARALLEL_STEP_WORKERS; t++) {
+        const struct QuickWorker* w = &s->workers[t];
+        if (w->busy) {
+            out[n++] = (struct Highlight){w->left_idx, HIGHLIGHT_WORKER, t};
+            out[n++] = (struct Highlight){w->right_idx, HIGHLIGHT_WORKER, t};
+            out[n++] = (struct Highlight){w->iter_idx, HIGHLIGHT_WORKER, t};
+        }
+    }
+    return n;
+}
+
+static void radix_lsd_init(void* state, int* arr, int len) { radix_lsd_sort_init(state, arr, len); }
+static void radix_lsd_step(void* state) { radix_lsd_sort_step(state); }
+static long long radix_lsd_step_n(void* state, long long n) { return radix_lsd_sort_step_n(state, n); }
+static bool radix_lsd_done(const void* state) { return ((const struct RadixLsdState*)state)->done; }
+static void radix_lsd_free(void* state) { radix_lsd_sort_free(state); }
+static void radix_lsd_set_write_log(void* state, struct WriteLog* log) { ((struct RadixLsdState*)state)->write_log = log; }
+static const struct Counters* radix_lsd_counters(const void* state) { return &((const struct RadixLsdState*)state)->counters; }
+
+static int radix_lsd_highlights(const void* state, struct Highlight* out) {
+    const struct RadixLsdState* s = state;
+    int n = 0;
+    if (s->phase == RADIX_LSD_COUNT && !s->done) {
+        out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_PRIMARY, 0};
+    } else if (s->phase == RADIX_LSD_SCATTER && s->write_idx >= 0) {
+        out[n++] = (struct Highlight){s->write_idx, HIGHLIGHT_SECONDARY, 0};
+    }
+    return n;
+}
+
+static int radix_lsd_histogram(const void* state, const int** counts, int* active) {
+    const struct RadixLsdState* s = state;
+    if (s->done) {
+        return 0;
+    }
+    *counts = s->counts;
+    *active = s->active_bucket;
+    return RADIX_BUCKETS;
+}
+
+static void radix_msd_init(void* state, int* arr, int len) { radix_msd_sort_init(state, arr, len); }
+static void radix_msd_step(void* state) { radix_msd_sort_step(state); }
+static long long radix_msd_step_n(void* state, long long n) { return radix_msd_sort_step_n(state, n); }
+static bool radix_msd_done(const void* state) { return ((const struct RadixMsdState*)state)->done; }
+static void radix_msd_set_write_log(void* state, struct WriteLog* log) { ((struct RadixMsdState*)state)->write_log = log; }
+static const struct Counters* radix_msd_counters(const void* state) { return &((const struct RadixMsdState*)state)->counters; }
+
+static int radix_msd_highlights(const void* state, struct Highlight* out) {
+    const struct RadixMsdState* s = state;
+    int n = 0;
+    if (s->done || s->phase == RADIX_MSD_NEXT_RANGE) {
+        return 0;
+    }
+    out[n++] = (struct Highlight){s->left_idx, HIGHLIGHT_PRIMARY, 0};
+    out[n++] = (struct Highlight){s->right_idx, HIGHLIGHT_PRIMARY, 0};
+    switch (s->phase) {
+    case RADIX_MSD_COUNT:
+        out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_TERTIARY, 0};
+        break;
+    case RADIX_MSD_PERMUTE:
+        if (s->iter_idx < RADIX_BUCKETS) {
+            out[n++] = (struct Highlight){s->heads[s->iter_idx], HIGHLIGHT_SECONDARY, 0};
+        }
+        if (s->swap_idx >= 0) {
+            out[n++] = (struct Highlight){s->swap_idx, HIGHLIGHT_TERTIARY, 0};
+        }
+        break;
+    case RADIX_MSD_INSERTION:
+        out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_TERTIARY, 0};
+        out[n++] = (struct Highlight){s->insert_idx, HIGHLIGHT_SECONDARY, 0};
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
+static int radix_msd_histogram(const void* state, const int** counts, int* active) {
+    const struct RadixMsdState* s = state;
+    // only ranges that are split by a digit have a histogram
+    if (s->done || s->phase == RADIX_MSD_NEXT_RANGE || s->phase == RADIX_MSD_INSERTION) {
+        return 0;
+    }
+    *counts = s->counts;
+    *active = s->phase == RADIX_MSD_COUNT ? -1 : s->iter_idx;
+    return RADIX_BUCKETS;
+}
+
+static void binary_insert_init(void* state, int* arr, int len) { binary_insert_sort_init(state, arr, len); }
+static void binary_insert_step(void* state) { binary_insert_sort_step(state); }
+static long long binary_insert_step_n(void* state, long long n) { return binary_insert_sort_step_n(state, n); }
+static bool binary_insert_done(const void* state) { return ((const struct BinaryInsertSortState*)state)->done; }
+static void binary_insert_set_write_log(void* state, struct WriteLog* log) {
+    ((struct BinaryInsertSortState*)state)->write_log = log;
+}
+static const struct Counters* binary_insert_counters(const void* state) {
+    return &((const struct BinaryInsertSortState*)state)->counters;
+}
+
+static int binary_insert_highlights(const void* state, struct Highlight* out) {
+    const struct BinaryInsertSortState* s = state;
+    int n = 0;
+    if (s->done) {
+        return 0;
+    }
+    out[n++] = (struct Highlight){s->iter_idx, HIGHLIGHT_PRIMARY, 0};
+    out[n++] = (struct Highlight){s->lo, HIGHLIGHT_SECONDARY, 0};
+    if (s->lo < s->hi) {
+        out[n++] = (struct Highlight){s->hi - 1, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->lo + (s->hi - s->lo) / 2, HIGHLIGHT_TERTIARY, 0};
+    }
+    return n;
+}
+
+static void tim_init(void* state, int* arr, int len) { tim_sort_init(state, arr, len); }
+static void tim_step(void* state) { tim_sort_step(state); }
+static long long tim_step_n(void* state, long long n) { return tim_sort_step_n(state, n); }
+static bool tim_done(const void* state) { return ((const struct TimSortState*)state)->done; }
+static void tim_free(void* state) { tim_sort_free(state); }
+static void tim_set_write_log(void* state, struct WriteLog* log) { ((struct TimSortState*)state)->write_log = log; }
+static const struct Counters* tim_counters(const void* state) { return &((const struct TimSortState*)state)->counters; }
+
+// runs on the stack beyond this many are not highlighted, only the newest ones
+#define TIM_SORT_HIGHLIGHT_RUNS 8
+
+static int tim_highlights(const void* state, struct Highlight* out) {
+    const struct TimSortState* s = state;
+    int n = 0;
+    if (s->done) {
+        return 0;
+    }
+    // the first element of every run waiting to be merged
+    int first_run = s->num_runs > TIM_SORT_HIGHLIGHT_RUNS ? s->num_runs - TIM_SORT_HIGHLIGHT_RUNS : 0;
+    for (int r = first_run; r < s->num_runs; r++) {
+        out[n++] = (struct Highlight){s->runs[r].start, HIGHLIGHT_PRIMARY, 0};
+    }
+    switch (s->phase) {
+    case TIM_SORT_FIND_RUN:
+        out[n++] = (struct Highlight){s->run_start, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->run_end - 1, HIGHLIGHT_SECONDARY, 0};
+        break;
+    case TIM_SORT_REVERSE:
+        out[n++] = (struct Highlight){s->reverse_lo, HIGHLIGHT_TERTIARY, 0};
+        out[n++] = (struct Highlight){s->reverse_hi, HIGHLIGHT_TERTIARY, 0};
+        break;
+    case TIM_SORT_EXTEND:
+        out[n++] = (struct Highlight){s->run_end, HIGHLIGHT_SECONDARY, 0};
+        out[n++] = (struct Highlight){s->lo, HIGHLIGHT_TERTIARY, 0};
+        break;
+    default:
+        // a merge, the last gallop jump and where the merge writes next
+        out[n++] = (struct Highlight){s->out_idx, HIGHLIGHT_SECONDARY, 0};
+        if (s->jump_from >= 0) {
+            out[n++] = (struct Highlight){s->jump_from, HIGHLIGHT_TERTIARY, 0};
+            out[n++] = (struct Highlight){s->jump_to, HIGHLIGHT_TERTIARY, 0};
+        }
+        break;
+    }
+    return n;
+}
+
+static void no_free(void* state) { (void)state; }
+
+static const struct Algorithm ALGORITHMS[NUM_ALGORITHM_TYPES] = {
+    [SELECTION_SORT] = {"selection", sizeof(struct SelectionSortState), selection_init, selection_step,
+                        selection_step_n, selection_highlights, selection_done, no_free, selection_set_write_log,
+                        NULL, NULL, selection_counters},
+    [INSERT_SORT] = {"insert", sizeof(struct InsertSortState), insert_init, insert_step,
+                     insert_step_n, insert_highlights, insert_done, no_free, insert_set_write_log, NULL,
+                     NULL, insert_counters},
+    [MERGE_SORT] = {"merge", sizeof(struct MergeSortState), merge_init_state, merge_step_state,
+                    merge_step_n, merge_highlights, merge_done, merge_free, merge_set_write_log,
+                    merge_step_n_fast, NULL, merge_counters},
+    [QUICK_SORT] = {"quick", sizeof(struct QuickSortState), quick_init, quick_step,
+                    quick_step_n, quick_highlights, quick_done, no_free, quick_set_write_log, NULL,
+                    NULL, quick_counters},
+    [BUBBLE_SORT] = {"bubble", sizeof(struct BubbleSortState), bubble_init, bubble_step,
+                     bubble_step_n, bubble_highlights, bubble_done, no_free, bubble_set_write_log, NULL,
+                     NULL, bubble_counters},
+    [INTRO_SORT] = {"intro", sizeof(struct IntroSortState), intro_init, intro_step,
+                    intro_step_n, intro_highlights, intro_done, no_free, intro_set_write_log, NULL,
+                    NULL, intro_counters},
+    [PARALLEL_MERGE_SORT] = {"parallel", sizeof(struct ParallelMergeSortState), parallel_init, parallel_step,
+                             parallel_step_n, parallel_highlights, parallel_done, parallel_free,
+                             parallel_set_write_log, NULL, NULL, parallel_counters},
+    [PARALLEL_QUICK_SORT] = {"parallel-quick", sizeof(struct ParallelQuickSortState), parallel_quick_init,
+                             parallel_quick_step, parallel_quick_step_n, parallel_quick_highlights,
+                             parallel_quick_done, no_free, parallel_quick_set_write_log, NULL, NULL,
+                             parallel_quick_counters},
+    [RADIX_LSD_SORT] = {"radix-lsd", sizeof(struct RadixLsdState), radix_lsd_init, radix_lsd_step,
+                        radix_lsd_step_n, radix_lsd_highlights, radix_lsd_done, radix_lsd_free,
+                        radix_lsd_set_write_log, NULL, radix_lsd_histogram, radix_lsd_counters},
+    [RADIX_MSD_SORT] = {"radix-msd", sizeof(struct RadixMsdState), radix_msd_init, radix_msd_step,
+                        radix_msd_step_n, radix_msd_highlights, radix_msd_done, no_free,
+                        radix_msd_set_write_log, NULL, radix_msd_histogram, radix_msd_counters},
+    [BINARY_INSERT_SORT] = {"binary-insert", sizeof(struct BinaryInsertSortState), binary_insert_init,
+                            binary_insert_step, binary_insert_step_n, binary_insert_highlights, binary_insert_done,
+                            no_free, binary_insert_set_write_log, NULL, NULL, binary_insert_counters},
+    [TIM_SORT] = {"timsort", sizeof(struct TimSortState), tim_init, tim_step, tim_step_n, tim_highlights, tim_done,
+                  tim_free, tim_set_write_log, NULL, NULL, tim_counters},
+};
+
+const struct Algorithm* get_algorithm(enum AlgorithmType type) {
+    if (type < 0 || type >= NUM_ALGORITHM_TYPES || ALGORITHMS[type].name == NULL) {
+        return NULL;
     }
+    return &ALGORITHMS[type];
 }
@@ -1,6 +1,95 @@
+#pragma once
+
 #include <stdbool.h>
 #include <stdlib.h>
 
+enum AlgorithmType {
+    SELECTION_SORT,
+    INSERT_SORT,
+    MERGE_SORT,
+    QUICK_SORT,
+    BUBBLE_SORT,
+    INTRO_SORT,
+    PARALLEL_MERGE_SORT,
+    PARALLEL_QUICK_SORT,
+    RADIX_LSD_SORT,
+    RADIX_MSD_SORT,
+    BINARY_INSERT_SORT,
+    TIM_SORT,
+    NUM_ALGORITHM_TYPES,
+};
+
+// what a highlighted index means, the renderer picks a color for each role
+enum HighlightRole {
+    HIGHLIGHT_PRIMARY,
+    HIGHLIGHT_SECONDARY,
+    HIGHLIGHT_TERTIARY,
+    HIGHLIGHT_WORKER, // owned by the worker thread in worker
+};
+
+struct Highlight {
+    int idx;
+    enum HighlightRole role;
+    int worker; // only used by HIGHLIGHT_WORKER
+};
+
+#define MAX_HIGHLIGHTS 16
+
+// Records the indices written by steps so that renderers only have to
+// redraw the columns that changed. A state only records its writes while its
+// write_log is set, the log is consumed and cleared by whoever set it.
+struct WriteLog {
+    int* indices;
+    int len;
+    int capacity;
+    bool overflow; // more than capacity writes since the last clear
+};
+
+bool write_log_init(struct WriteLog* log, int capacity);
+void write_log_free(struct WriteLog* log);
+void write_log_clear(struct WriteLog* log);
+
+static inline void log_write(struct WriteLog* log, int idx) {
+    if (log == NULL) {
+        return;
+    }
+    if (log->len < log->capacity) {
+        log->indices[log->len++] = idx;
+    } else {
+        log->overflow = true;
+    }
+}
+
+// Work done by an algorithm since its init. Every state keeps its counters
+// up to date, in the batched step_n functions exactly as in single steps, so
+// the totals do not depend on how the steps were run.
+struct Counters {
+    long long comparisons; // of two elements or of an element and a pivot
+    long long writes;      // of elements, to the array or to scratch memory
+    long long swaps;       // exchanges of two elements, also counted as two writes
+    long long allocations; // calls to malloc
+    long long aux_bytes;   // scratch memory currently allocated
+    long long aux_bytes_peak;
+};
+
+// count a call to malloc that returned ptr
+static inline void count_allocation(struct Counters* counters, const void* ptr, long long bytes) {
+    counters->allocations++;
+    if (ptr == NULL) {
+        return;
+    }
+    counters->aux_bytes += bytes;
+    if (counters->aux_bytes > counters->aux_bytes_peak) {
+        counters->aux_bytes_peak = counters->aux_bytes;
+    }
+}
+
+static inline void count_free(struct Counters* counters, const void* ptr, long long bytes) {
+    if (ptr != NULL) {
+        counters->aux_bytes -= bytes;
+    }
+}
+
 struct SelectionSortState {
     int* arr;
     int len;
@@ -8,6 +97,8 @@ struct SelectionSortState {
     int inner_idx; // index of the inner loop
     int min_idx;   // index of the minimum element found after index iter_idx
     bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
 };
 
 struct InsertSortState {
@@ -17,28 +108,224 @@ struct InsertSortState {
     int insert_idx; // index of the inner loop
     int value;      // value to be inserted
     bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+// insertion sort that finds the slot of each element by binary search, a
+// step is either one comparison of the search or moving the block behind
+// the slot and placing the element, so it takes O(n log n) steps
+struct BinaryInsertSortState {
+    int* arr;
+    int len;
+    int iter_idx; // element being inserted, arr[0, iter_idx) is sorted
+    // the slot is in [lo, hi], the search is over when they meet
+    int lo;
+    int hi;
+    int value; // value to be inserted
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+// the merge stack holds at most two frames per level of the recursion
+// tree plus one, which is below 64 for any array indexable by an int
+#define MERGE_SORT_MAX_FRAMES 64
+
+// a subarray [left_idx, right_idx] of the recursion tree, it is expanded
+// into its two halves the first time it is reached and merged the second
+struct MergeFrame {
+    int left_idx;
+    int right_idx;
+    bool expanded;
 };
 
 struct MergeSortState {
     int* arr;
     int len;
-    int* stack;
+    // explicit recursion stack used to generate the merges in the same
+    // order as merge_sort_recursive without precomputing all of them
+    struct MergeFrame stack[MERGE_SORT_MAX_FRAMES];
     int stack_ptr;
     int merge_left_idx;
     int merge_right_idx;
-    int* subarr_left;
-    int* subarr_right;
+    // scratch buffer of len ints allocated once in merge_sort_init, the left
+    // half of each merge is copied to the same position in scratch while the
+    // right half is read directly from arr
+    int* scratch;
     int subarr_left_idx;
     int subarr_right_idx;
     int merge_iter;
     bool done;
     bool merge_done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+// ranges of at most this many elements are finished with insertion sort
+#define QUICK_SORT_CUTOFF 16
+// ranges with more elements than this take the pivot from Tukey's ninther
+// (median of three medians of three) instead of a single median of three
+#define QUICK_SORT_NINTHER_THRESHOLD 128
+// the smaller partition is always sorted first, so there are never more than
+// log2(len) + 2 ranges waiting on the stack
+#define QUICK_SORT_MAX_RANGES 64
+
+enum QuickSortPhase {
+    QUICK_SORT_NEXT_RANGE, // pop the next range and pick its pivot
+    QUICK_SORT_PARTITION,  // three-way partition around the pivot
+    QUICK_SORT_INSERTION,  // insertion sort of a range below the cutoff
+};
+
+struct QuickSortRange {
+    int left_idx;
+    int right_idx;
+};
+
+struct QuickSortState {
+    int* arr;
+    int len;
+    // pending ranges, the smaller partition is on top
+    struct QuickSortRange stack[QUICK_SORT_MAX_RANGES];
+    int stack_ptr;
+    enum QuickSortPhase phase;
+    int left_idx;  // first index of the current range
+    int right_idx; // last index of the current range
+    int pivot;     // value the current range is partitioned around
+    // three-way partition of [left_idx, right_idx], elements in
+    // [left_idx, lt_idx) are less than the pivot, [lt_idx, iter_idx) equal to
+    // it and (gt_idx, right_idx] greater, [iter_idx, gt_idx] is unvisited
+    int lt_idx;
+    int iter_idx; // also the outer loop index of the insertion sort
+    int gt_idx;
+    int insert_idx; // inner loop index of the insertion sort
+    int value;      // value being inserted
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+// ranges of at most this many elements are finished with insertion sort
+#define INTRO_SORT_CUTOFF 24
+#define INTRO_SORT_MAX_RANGES 64
+
+enum IntroSortPhase {
+    INTRO_SORT_NEXT_RANGE, // pop the next range and pick its pivot
+    INTRO_SORT_PARTITION,  // partition around the pivot at left_idx
+    INTRO_SORT_INSERTION,  // insertion sort of a range below the cutoff
+    INTRO_SORT_HEAPSORT,   // heapsort of a range that ran out of budget
+};
+
+struct IntroSortRange {
+    int left_idx;
+    int right_idx;
+    int bad_allowed; // unbalanced partitions left before falling back to heapsort
+};
+
+// Pattern-defeating quicksort: quick sort with a ninther pivot that falls
+// back to heapsort for ranges that keep partitioning badly, which bounds the
+// worst case at O(n log n), and finishes small ranges with insertion sort.
+struct IntroSortState {
+    int* arr;
+    int len;
+    struct IntroSortRange stack[INTRO_SORT_MAX_RANGES];
+    int stack_ptr;
+    enum IntroSortPhase phase;
+    int left_idx;
+    int right_idx;
+    int bad_allowed;
+    // the pivot is kept at left_idx while partitioning, elements in
+    // (left_idx, i_idx) go left of it and elements in (j_idx, right_idx]
+    // right of it
+    int pivot;
+    int i_idx;
+    int j_idx;
+    // the range has a predecessor equal to the pivot, which means the pivot
+    // is the smallest element, so elements equal to it go left and are done
+    bool partition_left;
+    int insert_idx; // inner loop of the insertion sort, i_idx is the outer one
+    int value;
+    // heapsort of [left_idx, left_idx + heap_len) as a max heap, heap_start
+    // is the next node to sift down while building it and is -1 afterwards
+    int heap_len;
+    int heap_start;
+    int sift_idx; // node being sifted down, -1 if none
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+struct BubbleSortState {
+    int* arr;
+    int len;
+    int iter_idx;  // number of passes done, the last iter_idx elements are sorted
+    int inner_idx; // compares inner_idx and inner_idx + 1
+    bool swapped;  // a swap happened during the current pass
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
 };
 
 void selection_sort_init(struct SelectionSortState* state, int arr[], int n);
 void insert_sort_init(struct InsertSortState* state, int* arr, int n);
 void merge_sort_init(struct MergeSortState* state, int* arr, int len);
+void quick_sort_init(struct QuickSortState* state, int* arr, int len);
+void bubble_sort_init(struct BubbleSortState* state, int* arr, int len);
+void intro_sort_init(struct IntroSortState* state, int* arr, int len);
+void binary_insert_sort_init(struct BinaryInsertSortState* state, int* arr, int len);
 
 void selection_sort_step(struct SelectionSortState* s);
 void insert_sort_step(struct InsertSortState* s);
 void merge_sort_step(struct MergeSortState* state);
+void quick_sort_step(struct QuickSortState* state);
+void bubble_sort_step(struct BubbleSortState* state);
+void intro_sort_step(struct IntroSortState* state);
+void binary_insert_sort_step(struct BinaryInsertSortState* state);
+
+// run at most n steps, returns the number of steps taken
+long long selection_sort_step_n(struct SelectionSortState* s, long long n);
+long long insert_sort_step_n(struct InsertSortState* s, long long n);
+long long merge_sort_step_n(struct MergeSortState* state, long long n);
+long long quick_sort_step_n(struct QuickSortState* state, long long n);
+long long bubble_sort_step_n(struct BubbleSortState* state, long long n);
+long long intro_sort_step_n(struct IntroSortState* state, long long n);
+long long binary_insert_sort_step_n(struct BinaryInsertSortState* state, long long n);
+
+// same as merge_sort_step_n, but a batch that covers the rest of the current
+// merge finishes it with simd_merge, the array, the write log and the step
+// count end up exactly as with merge_sort_step_n
+long long merge_sort_step_n_fast(struct MergeSortState* state, long long n);
+
+// release memory owned by the state, safe to call on a zero initialized state
+void merge_sort_free(struct MergeSortState* state);
+
+// index of the pivot quick sort picks for [left_idx, right_idx], the median
+// of three or above QUICK_SORT_NINTHER_THRESHOLD elements Tukey's ninther,
+// adds the comparisons it makes to comparisons unless that is NULL
+int quick_sort_pivot(const int* arr, int left_idx, int right_idx, long long* comparisons);
+
+// Common interface of the stepwise algorithms, state points to a block of
+// state_size bytes owned by the caller
+struct Algorithm {
+    const char* name;
+    size_t state_size;
+    void (*init)(void* state, int* arr, int len);
+    void (*step)(void* state);
+    long long (*step_n)(void* state, long long n);
+    // fills out with at most MAX_HIGHLIGHTS highlights, returns how many
+    int (*highlights)(const void* state, struct Highlight* out);
+    bool (*done)(const void* state);
+    void (*free)(void* state);
+    void (*set_write_log)(void* state, struct WriteLog* log);
+    // optional step_n that uses the vectorized kernels of simd.h where it
+    // can, NULL if the algorithm has no fast path
+    long long (*step_n_fast)(void* state, long long n);
+    // optional bucket counters to draw over the chart, sets counts and the
+    // bucket being worked on (-1 if none) and returns the number of
+    // buckets, 0 while there are none, NULL for comparison sorts
+    int (*histogram)(const void* state, const int** counts, int* active);
+    const struct Counters* (*counters)(const void* state);
+};
+
+// NULL for algorithm types without a stepwise implementation
+const struct Algorithm* get_algorithm(enum AlgorithmType type);
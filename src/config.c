@@ -0,0 +1,238 @@
+#include "config.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_NUM_ELEMENTS (1 << 28)
+#define MAX_WINDOW_SIZE 16384
+#define MAX_CONFIG_LINE 256
+// config files may include others this many levels deep, which also stops
+// a file that includes itself
+#define MAX_CONFIG_DEPTH 8
+
+const char* algorithm_name(enum AlgorithmType type) {
+    const struct Algorithm* algorithm = get_algorithm(type);
+    return algorithm != NULL ? algorithm->name : "unknown";
+}
+
+bool parse_algorithm(const char* name, enum AlgorithmType* type) {
+    for (int i = 0; i < NUM_ALGORITHM_TYPES; i++) {
+        const struct Algorithm* algorithm = get_algorithm(i);
+        if (algorithm != NULL && strcmp(name, algorithm->name) == 0) {
+            *type = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void config_init(struct Config* config) {
+    config->algorithm = SELECTION_SORT;
+    config->num_elements = 160;
+    config->width = 640;
+    config->height = 480;
+    config->fps = 100;
+    config->vsync = false;
+    config->steps_per_frame = 1;
+    config->distribution = DIST_RANDOM;
+    config->seed = 0;
+    config->simd_level = simd_detect();
+    config->fast_path = false;
+    config->record_path[0] = '\0';
+    config->replay_path[0] = '\0';
+    config->trace_mmap = true;
+    config->export_path[0] = '\0';
+    config->export_format = EXPORT_PPM;
+    config->counters_path[0] = '\0';
+    config->timing = false;
+    config->threaded = false;
+}
+
+void config_print_usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --algorithm NAME     selection, insert, merge, quick,\n"
+            "                       bubble, intro, parallel,\n"
+            "                       parallel-quick, radix-lsd, radix-msd,\n"
+            "                       binary-insert, timsort\n"
+            "  --size N             number of elements (1 to %d)\n"
+            "  --width N            window width in pixels\n"
+            "  --height N           window height in pixels\n"
+            "  --fps N              target frames per second\n"
+            "  --vsync 0|1          pace the frames to the display instead\n"
+            "  --steps N            algorithm steps per frame\n"
+            "  --dist NAME          uniform, sorted, reversed, few-unique,\n"
+            "                       organ-pipe, nearly-sorted, sawtooth\n"
+            "  --seed N             seed of the input generator\n"
+            "  --simd LEVEL         scalar, sse4, avx2 (default: best supported)\n"
+            "  --fast-path 0|1      batch steps with the vectorized kernels\n"
+            "  --record FILE        write a trace of the run to FILE (headless)\n"
+            "  --replay FILE        play back the trace in FILE instead of sorting\n"
+            "  --mmap 0|1           map the replayed trace instead of reading it\n"
+            "  --export PATH        write frames to PATH, a pattern such as\n"
+            "                       frames/%%06d.png or - for stdout (headless)\n"
+            "  --format NAME        ppm, png, raw (frames of --export)\n"
+            "  --counters FILE      write the counters of the run as JSON to\n"
+            "                       FILE or - for stdout (headless)\n"
+            "  --timing 0|1         histogram of the cycles every step takes,\n"
+            "                       runs single steps (headless)\n"
+            "  --threaded 0|1       sort on a worker thread while drawing\n"
+            "  --config FILE        read `option = value` lines from FILE\n",
+            prog,
+            MAX_NUM_ELEMENTS);
+}
+
+static bool parse_int(const char* value, int min, int max, int* out) {
+    char* end;
+    errno = 0;
+    long v = strtol(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || v < min || v > max) {
+        return false;
+    }
+    *out = (int)v;
+    return true;
+}
+
+// 0 or 1, out is only written if value is valid
+static bool parse_flag(const char* value, bool* out) {
+    int v;
+    if (!parse_int(value, 0, 1, &v)) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+static bool parse_config_file(struct Config* config, const char* path, int depth);
+
+// apply a single option, name is given without the leading dashes, depth is
+// the number of config files it is nested in
+static bool set_option(struct Config* config, const char* name, const char* value, int depth) {
+    bool ok;
+    if (strcmp(name, "algorithm") == 0) {
+        ok = parse_algorithm(value, &config->algorithm);
+    } else if (strcmp(name, "size") == 0) {
+        ok = parse_int(value, 1, MAX_NUM_ELEMENTS, &config->num_elements);
+    } else if (strcmp(name, "width") == 0) {
+        ok = parse_int(value, 1, MAX_WINDOW_SIZE, &config->width);
+    } else if (strcmp(name, "height") == 0) {
+        ok = parse_int(value, 1, MAX_WINDOW_SIZE, &config->height);
+    } else if (strcmp(name, "fps") == 0) {
+        ok = parse_int(value, 1, 1000, &config->fps);
+    } else if (strcmp(name, "vsync") == 0) {
+        ok = parse_flag(value, &config->vsync);
+    } else if (strcmp(name, "steps") == 0) {
+        ok = parse_int(value, 1, MAX_STEPS_PER_FRAME, &config->steps_per_frame);
+    } else if (strcmp(name, "dist") == 0) {
+        ok = parse_distribution(value, &config->distribution);
+    } else if (strcmp(name, "seed") == 0) {
+        char* end;
+        config->seed = strtoull(value, &end, 10);
+        ok = end != value && *end == '\0';
+    } else if (strcmp(name, "simd") == 0) {
+        // levels above simd_detect() would run instructions the CPU lacks
+        ok = parse_simd_level(value, &config->simd_level) && config->simd_level <= simd_detect();
+    } else if (strcmp(name, "fast-path") == 0) {
+        ok = parse_flag(value, &config->fast_path);
+    } else if (strcmp(name, "record") == 0 || strcmp(name, "replay") == 0) {
+        char* path = strcmp(name, "record") == 0 ? config->record_path : config->replay_path;
+        ok = *value != '\0' && strlen(value) < CONFIG_MAX_PATH;
+        if (ok) {
+            strcpy(path, value);
+        }
+    } else if (strcmp(name, "export") == 0) {
+        ok = export_path_valid(value) && strlen(value) < CONFIG_MAX_PATH;
+        if (ok) {
+            strcpy(config->export_path, value);
+        }
+    } else if (strcmp(name, "format") == 0) {
+        ok = parse_export_format(value, &config->export_format);
+    } else if (strcmp(name, "counters") == 0) {
+        ok = *value != '\0' && strlen(value) < CONFIG_MAX_PATH;
+        if (ok) {
+            strcpy(config->counters_path, value);
+        }
+    } else if (strcmp(name, "timing") == 0) {
+        ok = parse_flag(value, &config->timing);
+    } else if (strcmp(name, "threaded") == 0) {
+        ok = parse_flag(value, &config->threaded);
+    } else if (strcmp(name, "mmap") == 0) {
+        ok = parse_flag(value, &config->trace_mmap);
+    } else if (strcmp(name, "config") == 0) {
+        if (depth >= MAX_CONFIG_DEPTH) {
+            fprintf(stderr, "config files nested more than %d deep: %s\n", MAX_CONFIG_DEPTH, value);
+            return false;
+        }
+        return parse_config_file(config, value, depth + 1);
+    } else {
+        fprintf(stderr, "unknown option: %s\n", name);
+        return false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "invalid value for %s: %s\n", name, value);
+    }
+    return ok;
+}
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+static bool parse_config_file(struct Config* config, const char* path, int depth) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "could not open config file: %s\n", path);
+        return false;
+    }
+
+    char line[MAX_CONFIG_LINE];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        // everything after a # is a comment
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char* name = trim(line);
+        if (*name == '\0') {
+            continue;
+        }
+        char* eq = strchr(name, '=');
+        if (eq == NULL) {
+            fprintf(stderr, "%s:%d: expected `option = value`\n", path, line_number);
+            ok = false;
+            break;
+        }
+        *eq = '\0';
+        ok = set_option(config, trim(name), trim(eq + 1), depth);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+bool config_parse_args(struct Config* config, int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0 || i + 1 >= argc) {
+            fprintf(stderr, "expected `--option value`, got: %s\n", arg);
+            return false;
+        }
+        if (!set_option(config, arg + 2, argv[++i], 0)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "algorithms.h"
+#include "datagen.h"
+#include "export.h"
+#include "simd.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONFIG_MAX_PATH 256
+// limit of --steps and of doubling the steps per frame with the UP key
+#define MAX_STEPS_PER_FRAME (1 << 24)
+
+// Runtime settings shared by the visualizer and the headless runner. They
+// are read from command line options, --config FILE reads the same options
+// from a file with one `option = value` per line.
+struct Config {
+    enum AlgorithmType algorithm;
+    int num_elements;
+    int width;  // window width in pixels
+    int height; // window height in pixels
+    int fps;    // target frames per second without vsync
+    bool vsync; // pace the frames to the display
+    int steps_per_frame;
+    enum Distribution distribution;
+    uint64_t seed;
+    enum SimdLevel simd_level; // kernels used by simd.h
+    bool fast_path;            // see engine_set_fast_path
+    // trace files, see trace.h, empty if not used
+    char record_path[CONFIG_MAX_PATH]; // headless runner only
+    char replay_path[CONFIG_MAX_PATH]; // visualizer only
+    bool trace_mmap;                   // map replayed traces instead of reading them
+    // frames of the headless runner, see export.h, empty if not exported
+    char export_path[CONFIG_MAX_PATH];
+    enum ExportFormat export_format;
+    // JSON dump of the counters of the headless run, "-" for stdout, empty
+    // if not written
+    char counters_path[CONFIG_MAX_PATH];
+    bool timing;   // see engine_set_timing
+    bool threaded; // step on a worker thread, see worker.h (visualizer only)
+};
+
+void config_init(struct Config* config);
+// returns false and prints the reason to stderr on invalid options
+bool config_parse_args(struct Config* config, int argc, char** argv);
+void config_print_usage(const char* prog);
+
+const char* algorithm_name(enum AlgorithmType type);
+bool parse_algorithm(const char* name, enum AlgorithmType* type);
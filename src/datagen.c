@@ -0,0 +1,129 @@
+#include "datagen.h"
+#include <string.h>
+
+// number of distinct values used by DIST_FEW_UNIQUE
+#define FEW_UNIQUE_VALUES 16
+// DIST_NEARLY_SORTED swaps one random pair per this many elements
+#define NEARLY_SORTED_SWAP_RATIO 100
+// number of ascending ramps in DIST_SAWTOOTH
+#define SAWTOOTH_TEETH 8
+
+static const char* const DISTRIBUTION_NAMES[NUM_DISTRIBUTIONS] = {
+    [DIST_RANDOM] = "random",
+    [DIST_SORTED] = "sorted",
+    [DIST_REVERSED] = "reversed",
+    [DIST_FEW_UNIQUE] = "few-unique",
+    [DIST_ORGAN_PIPE] = "organ-pipe",
+    [DIST_NEARLY_SORTED] = "nearly-sorted",
+    [DIST_SAWTOOTH] = "sawtooth",
+};
+
+// ================== PRNG ==================
+// splitmix64, fast and more than good enough for generating test data
+void rng_seed(struct Rng* rng, uint64_t seed) { rng->state = seed; }
+
+uint64_t rng_next(struct Rng* rng) {
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+int rng_range(struct Rng* rng, int min, int max) {
+    // multiply-shift instead of modulo, the bias is negligible for our ranges
+    uint64_t span = (uint64_t)((int64_t)max - min) + 1;
+    return (int)(min + (int64_t)(((rng_next(rng) >> 32) * span) >> 32));
+}
+
+// ================== Distributions ==================
+const char* distribution_name(enum Distribution dist) {
+    if (dist < 0 || dist >= NUM_DISTRIBUTIONS) {
+        return "unknown";
+    }
+    return DISTRIBUTION_NAMES[dist];
+}
+
+bool parse_distribution(const char* name, enum Distribution* dist) {
+    if (strcmp(name, "uniform") == 0) {
+        *dist = DIST_RANDOM;
+        return true;
+    }
+    for (int i = 0; i < NUM_DISTRIBUTIONS; i++) {
+        if (strcmp(name, DISTRIBUTION_NAMES[i]) == 0) {
+            *dist = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// value at position i of an ascending ramp of len values spanning [min, max]
+static int ramp(int i, int len, int min, int max) {
+    if (len <= 1) {
+        return min;
+    }
+    return (int)(min + ((int64_t)max - min) * i / (len - 1));
+}
+
+void generate(int* arr, int len, enum Distribution dist, int min, int max, uint64_t seed) {
+    struct Rng rng;
+    rng_seed(&rng, seed);
+
+    switch (dist) {
+    case DIST_RANDOM:
+        for (int i = 0; i < len; i++) {
+            arr[i] = rng_range(&rng, min, max);
+        }
+        break;
+    case DIST_SORTED:
+        for (int i = 0; i < len; i++) {
+            arr[i] = ramp(i, len, min, max);
+        }
+        break;
+    case DIST_REVERSED:
+        for (int i = 0; i < len; i++) {
+            arr[i] = ramp(len - 1 - i, len, min, max);
+        }
+        break;
+    case DIST_FEW_UNIQUE:
+        for (int i = 0; i < len; i++) {
+            int k = rng_range(&rng, 0, FEW_UNIQUE_VALUES - 1);
+            arr[i] = ramp(k, FEW_UNIQUE_VALUES, min, max);
+        }
+        break;
+    case DIST_ORGAN_PIPE: {
+        // ascending up to the middle, then descending
+        int half = (len + 1) / 2;
+        for (int i = 0; i < len; i++) {
+            int k = i < half ? i : len - 1 - i;
+            arr[i] = ramp(k, half, min, max);
+        }
+        break;
+    }
+    case DIST_NEARLY_SORTED: {
+        // sorted with a few random pairs swapped
+        for (int i = 0; i < len; i++) {
+            arr[i] = ramp(i, len, min, max);
+        }
+        int swaps = len / NEARLY_SORTED_SWAP_RATIO + (len > 1 ? 1 : 0);
+        for (int k = 0; k < swaps; k++) {
+            int i = rng_range(&rng, 0, len - 1);
+            int j = rng_range(&rng, 0, len - 1);
+            int temp = arr[i];
+            arr[i] = arr[j];
+            arr[j] = temp;
+        }
+        break;
+    }
+    case DIST_SAWTOOTH: {
+        // SAWTOOTH_TEETH ascending ramps one after the other
+        int tooth = (len + SAWTOOTH_TEETH - 1) / SAWTOOTH_TEETH;
+        for (int i = 0; i < len; i++) {
+            arr[i] = ramp(i % tooth, tooth, min, max);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
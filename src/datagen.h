@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Input generators shared by the visualizer, the headless runner and the
+// benchmarks. All generators are driven by a small seeded PRNG so runs are
+// reproducible.
+
+enum Distribution {
+    DIST_RANDOM,
+    DIST_SORTED,
+    DIST_REVERSED,
+    DIST_FEW_UNIQUE,
+    DIST_ORGAN_PIPE,
+    DIST_NEARLY_SORTED,
+    DIST_SAWTOOTH,
+    NUM_DISTRIBUTIONS,
+};
+
+struct Rng {
+    uint64_t state;
+};
+
+void rng_seed(struct Rng* rng, uint64_t seed);
+uint64_t rng_next(struct Rng* rng);
+// uniformly distributed value in [min, max]
+int rng_range(struct Rng* rng, int min, int max);
+
+const char* distribution_name(enum Distribution dist);
+// also accepts "uniform" for DIST_RANDOM
+bool parse_distribution(const char* name, enum Distribution* dist);
+
+// fill arr with len values in [min, max] following the distribution dist
+void generate(int* arr, int len, enum Distribution dist, int min, int max, uint64_t seed);
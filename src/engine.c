@@ -0,0 +1,149 @@
+#include "engine.h"
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// how many steps to run between reading the clock in engine_step_for,
+// reading the clock is a lot more expensive than a single step
+#define STEPS_PER_CLOCK_CHECK 256
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// cycle counter for step latencies, falls back to the monotonic clock
+static inline unsigned long long now_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+static int latency_bucket(unsigned long long ticks) {
+    int bucket = ticks == 0 ? 0 : 63 - __builtin_clzll(ticks);
+    return bucket < ENGINE_LATENCY_BUCKETS ? bucket : ENGINE_LATENCY_BUCKETS - 1;
+}
+
+bool engine_init(struct Engine* engine, enum AlgorithmType type, int* arr, int len) {
+    engine->algorithm_type = type;
+    engine->algorithm = get_algorithm(type);
+    engine->state = NULL;
+    engine->steps = 0;
+    engine->fast_path = false;
+    engine->timing = false;
+    memset(engine->latency, 0, sizeof(engine->latency));
+
+    // only the active algorithm has a state
+    if (engine->algorithm == NULL) {
+        return true;
+    }
+    engine->state = malloc(engine->algorithm->state_size);
+    if (engine->state == NULL) {
+        engine->algorithm = NULL;
+        return false;
+    }
+    engine->algorithm->init(engine->state, arr, len);
+    return true;
+}
+
+void engine_free(struct Engine* engine) {
+    if (engine->state != NULL) {
+        engine->algorithm->free(engine->state);
+        free(engine->state);
+    }
+    engine->state = NULL;
+    engine->algorithm = NULL;
+}
+
+bool engine_done(const struct Engine* engine) {
+    // algorithms without a step implementation are never started
+    return engine->state == NULL || engine->algorithm->done(engine->state);
+}
+
+void engine_set_write_log(struct Engine* engine, struct WriteLog* log) {
+    if (engine->state != NULL) {
+        engine->algorithm->set_write_log(engine->state, log);
+    }
+}
+
+void engine_set_fast_path(struct Engine* engine, bool fast_path) {
+    engine->fast_path = fast_path;
+}
+
+void engine_set_timing(struct Engine* engine, bool timing) {
+    engine->timing = timing;
+}
+
+struct Counters engine_counters(const struct Engine* engine) {
+    if (engine->state == NULL) {
+        return (struct Counters){0};
+    }
+    return *engine->algorithm->counters(engine->state);
+}
+
+int engine_highlights(const struct Engine* engine, struct Highlight* out) {
+    if (engine->state == NULL) {
+        return 0;
+    }
+    return engine->algorithm->highlights(engine->state, out);
+}
+
+int engine_histogram(const struct Engine* engine, const int** counts, int* active) {
+    if (engine->state == NULL || engine->algorithm->histogram == NULL) {
+        return 0;
+    }
+    return engine->algorithm->histogram(engine->state, counts, active);
+}
+
+long long engine_step_n(struct Engine* engine, long long n) {
+    if (engine->state == NULL) {
+        return 0;
+    }
+    if (engine->timing) {
+        long long steps = 0;
+        while (steps < n && !engine->algorithm->done(engine->state)) {
+            unsigned long long start = now_ticks();
+            engine->algorithm->step(engine->state);
+            engine->latency[latency_bucket(now_ticks() - start)]++;
+            steps++;
+        }
+        engine->steps += steps;
+        return steps;
+    }
+    // a single indirect call per batch, the loop itself runs inside the
+    // algorithm where the step function can be inlined
+    long long (*step_n)(void*, long long) = engine->algorithm->step_n;
+    if (engine->fast_path && engine->algorithm->step_n_fast != NULL) {
+        step_n = engine->algorithm->step_n_fast;
+    }
+    long long steps = step_n(engine->state, n);
+    engine->steps += steps;
+    return steps;
+}
+
+long long engine_step_for(struct Engine* engine, double budget_ms) {
+    double deadline = now_ms() + budget_ms;
+    long long steps = 0;
+    while (!engine_done(engine)) {
+        steps += engine_step_n(engine, STEPS_PER_CLOCK_CHECK);
+        if (now_ms() >= deadline) {
+            break;
+        }
+    }
+    return steps;
+}
+
+long long engine_run(struct Engine* engine) {
+    long long steps = 0;
+    while (!engine_done(engine)) {
+        steps += engine_step_n(engine, 1 << 20);
+    }
+    return steps;
+}
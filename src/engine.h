@@ -0,0 +1,51 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+
+// step latencies are kept as a histogram of floor(log2(cycles)), on targets
+// without a cycle counter the unit is nanoseconds instead
+#define ENGINE_LATENCY_BUCKETS 48
+
+// The engine owns the state of the active algorithm and advances it
+// independently of rendering, so a frame can run any number of steps
+// (or as many as fit in a time budget) before it is drawn
+struct Engine {
+    enum AlgorithmType algorithm_type;
+    const struct Algorithm* algorithm; // NULL if the type is not implemented
+    void* state;                       // algorithm->state_size bytes
+    long long steps;                   // number of steps taken since engine_init
+    bool fast_path;                    // use algorithm->step_n_fast where there is one
+    bool timing;                       // time every step into latency
+    long long latency[ENGINE_LATENCY_BUCKETS];
+};
+
+// returns false if the state could not be allocated, the engine is then done
+bool engine_init(struct Engine* engine, enum AlgorithmType type, int* arr, int len);
+// release memory owned by the active algorithm, must be called before
+// engine_init is called again on the same engine
+void engine_free(struct Engine* engine);
+bool engine_done(const struct Engine* engine);
+// record the indices written by the active algorithm in log, NULL disables it
+void engine_set_write_log(struct Engine* engine, struct WriteLog* log);
+// let the active algorithm batch steps with the vectorized kernels of simd.h,
+// the result and step count are the same, off after engine_init
+void engine_set_fast_path(struct Engine* engine, bool fast_path);
+// time every step into engine->latency, steps then run one at a time and
+// without the fast path so the numbers describe single steps, off after
+// engine_init
+void engine_set_timing(struct Engine* engine, bool timing);
+// counters of the active algorithm, all zero if there is none
+struct Counters engine_counters(const struct Engine* engine);
+// fills out with at most MAX_HIGHLIGHTS highlights, returns how many
+int engine_highlights(const struct Engine* engine, struct Highlight* out);
+// bucket counters of the active algorithm, see Algorithm.histogram, returns
+// 0 if there are none
+int engine_histogram(const struct Engine* engine, const int** counts, int* active);
+
+// run at most n steps, returns the number of steps actually taken
+long long engine_step_n(struct Engine* engine, long long n);
+// run steps until budget_ms milliseconds have passed or the algorithm is done
+long long engine_step_for(struct Engine* engine, double budget_ms);
+// run the algorithm to completion as fast as possible
+long long engine_run(struct Engine* engine);
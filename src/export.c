@@ -0,0 +1,508 @@
+#include "export.h"
+#include "lod.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAME_PATH 512
+
+static const char* const EXPORT_FORMAT_NAMES[NUM_EXPORT_FORMATS] = {
+    [EXPORT_PPM] = "ppm",
+    [EXPORT_PNG] = "png",
+    [EXPORT_RAW] = "raw",
+};
+
+const char* export_format_name(enum ExportFormat format) {
+    if (format < 0 || format >= NUM_EXPORT_FORMATS) {
+        return "unknown";
+    }
+    return EXPORT_FORMAT_NAMES[format];
+}
+
+bool parse_export_format(const char* name, enum ExportFormat* format) {
+    for (int i = 0; i < NUM_EXPORT_FORMATS; i++) {
+        if (strcmp(name, EXPORT_FORMAT_NAMES[i]) == 0) {
+            *format = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool export_path_valid(const char* path) {
+    if (strcmp(path, "-") == 0) {
+        return true;
+    }
+    // exactly one %d with an optional zero flag and width, %% is allowed
+    int conversions = 0;
+    for (const char* c = path; *c != '\0'; c++) {
+        if (*c != '%') {
+            continue;
+        }
+        if (c[1] == '%') {
+            c++;
+            continue;
+        }
+        c++;
+        while (isdigit((unsigned char)*c)) {
+            c++;
+        }
+        if (*c != 'd') {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1 && strlen(path) < MAX_FRAME_PATH / 2;
+}
+
+// ================== PNG ==================
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void init_crc_table(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t len) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (len > 0) {
+        // the sums cannot overflow within 5552 bytes
+        size_t block = len < 5552 ? len : 5552;
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        len -= block;
+    }
+    return b << 16 | a;
+}
+
+static uint8_t* put_u32(uint8_t* out, uint32_t v) {
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+    return out + 4;
+}
+
+struct BitWriter {
+    uint8_t* out;
+    size_t len;
+    uint64_t bits;
+    int num_bits;
+};
+
+static void put_bits(struct BitWriter* writer, uint32_t value, int n) {
+    writer->bits |= (uint64_t)value << writer->num_bits;
+    writer->num_bits += n;
+    while (writer->num_bits >= 8) {
+        writer->out[writer->len++] = (uint8_t)writer->bits;
+        writer->bits >>= 8;
+        writer->num_bits -= 8;
+    }
+}
+
+// Huffman codes are stored starting with their most significant bit
+static void put_code(struct BitWriter* writer, uint32_t code, int n) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < n; i++) {
+        reversed = reversed << 1 | ((code >> i) & 1);
+    }
+    put_bits(writer, reversed, n);
+}
+
+// literal/length symbol with the fixed codes of RFC 1951 3.2.6
+static void put_symbol(struct BitWriter* writer, int symbol) {
+    if (symbol < 144) {
+        put_code(writer, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        put_code(writer, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        put_code(writer, symbol - 256, 7);
+    } else {
+        put_code(writer, 0xC0 + symbol - 280, 8);
+    }
+}
+
+static const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+// repeat the previous byte len times, a match at distance 1
+static void put_repeat(struct BitWriter* writer, int len) {
+    int i = 28;
+    while (LENGTH_BASE[i] > len) {
+        i--;
+    }
+    put_symbol(writer, 257 + i);
+    put_bits(writer, len - LENGTH_BASE[i], LENGTH_EXTRA[i]);
+    put_code(writer, 0, 5);
+}
+
+// A single fixed Huffman block whose only matches are runs of the same byte.
+// The rows are filtered against the row above, which turns the columns of
+// the chart into long runs of zeros, so that is enough to shrink a frame to
+// a few percent. out needs room for len * 9 / 8 + 16 bytes.
+static size_t deflate_runs(const uint8_t* data, size_t len, uint8_t* out) {
+    struct BitWriter writer = {out, 0, 0, 0};
+    put_bits(&writer, 1, 1); // last block
+    put_bits(&writer, 1, 2); // fixed codes
+    size_t i = 0;
+    while (i < len) {
+        uint8_t byte = data[i];
+        size_t run = 1;
+        while (i + run < len && data[i + run] == byte) {
+            run++;
+        }
+        put_symbol(&writer, byte);
+        size_t left = run - 1;
+        while (left >= MIN_MATCH) {
+            int match = left < MAX_MATCH ? (int)left : MAX_MATCH;
+            put_repeat(&writer, match);
+            left -= match;
+        }
+        for (; left > 0; left--) {
+            put_symbol(&writer, byte);
+        }
+        i += run;
+    }
+    put_symbol(&writer, 256);
+    if (writer.num_bits > 0) {
+        put_bits(&writer, 0, 8 - writer.num_bits);
+    }
+    return writer.len;
+}
+
+static uint8_t* put_chunk(uint8_t* out, const char* type, const uint8_t* data, size_t len) {
+    out = put_u32(out, (uint32_t)len);
+    uint8_t* start = out;
+    memcpy(out, type, 4);
+    if (len > 0 && out + 4 != data) {
+        memmove(out + 4, data, len);
+    }
+    out += 4 + len;
+    return put_u32(out, crc32(start, len + 4));
+}
+
+// ================== Encoder ==================
+static size_t raw_row_len(const struct Exporter* exporter) {
+    return (size_t)exporter->width * (exporter->format == EXPORT_RAW ? 4 : 3);
+}
+
+static size_t scratch_size(const struct Exporter* exporter) {
+    size_t rows = (raw_row_len(exporter) + 1) * exporter->height;
+    if (exporter->format != EXPORT_PNG) {
+        return rows;
+    }
+    // filtered rows followed by the file, the deflated rows can be 9/8 of
+    // their size plus the zlib and chunk framing
+    return rows + rows + rows / 8 + 256;
+}
+
+// convert the frame to RGB(A) rows, with a filter byte per row for PNG
+static void pack_rows(const struct Exporter* exporter, const struct Raster* frame, uint8_t* out) {
+    bool png = exporter->format == EXPORT_PNG;
+    bool alpha = exporter->format == EXPORT_RAW;
+    size_t row_len = raw_row_len(exporter);
+    for (int y = 0; y < frame->height; y++) {
+        const uint32_t* line = frame->pixels + (size_t)y * frame->width;
+        uint8_t* row = out + (size_t)y * (row_len + png);
+        if (png) {
+            *row++ = y == 0 ? 0 : 2; // none for the first row, up for the rest
+        }
+        for (int x = 0; x < frame->width; x++) {
+            uint32_t p = line[x];
+            *row++ = (uint8_t)(p >> 16);
+            *row++ = (uint8_t)(p >> 8);
+            *row++ = (uint8_t)p;
+            if (alpha) {
+                *row++ = (uint8_t)(p >> 24);
+            }
+        }
+    }
+    if (png) {
+        // filter bottom up so every row is still unfiltered when the row
+        // below it is filtered against it
+        for (int y = frame->height - 1; y > 0; y--) {
+            uint8_t* row = out + (size_t)y * (row_len + 1) + 1;
+            const uint8_t* above = row - (row_len + 1);
+            for (size_t i = 0; i < row_len; i++) {
+                row[i] -= above[i];
+            }
+        }
+    }
+}
+
+static size_t encode_png(struct Exporter* exporter, size_t rows_len, uint8_t** file) {
+    uint8_t* rows = exporter->scratch;
+    uint8_t* out = rows + rows_len;
+    uint8_t* p = out;
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    memcpy(p, SIGNATURE, sizeof(SIGNATURE));
+    p += sizeof(SIGNATURE);
+
+    uint8_t header[13];
+    put_u32(header, exporter->width);
+    put_u32(header + 4, exporter->height);
+    header[8] = 8;  // bits per channel
+    header[9] = 2;  // RGB
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filters
+    header[12] = 0; // not interlaced
+    p = put_chunk(p, "IHDR", header, sizeof(header));
+
+    // the zlib stream is written in place of the IDAT data
+    uint8_t* data = p + 8;
+    data[0] = 0x78; // deflate, 32K window
+    data[1] = 0x01; // no dictionary, check bits
+    size_t len = 2 + deflate_runs(rows, rows_len, data + 2);
+    put_u32(data + len, adler32(rows, rows_len));
+    len += 4;
+    p = put_chunk(p, "IDAT", data, len);
+    p = put_chunk(p, "IEND", NULL, 0);
+
+    *file = out;
+    return (size_t)(p - out);
+}
+
+static bool write_frame(struct Exporter* exporter, const struct Raster* frame) {
+    size_t rows_len = (raw_row_len(exporter) + (exporter->format == EXPORT_PNG)) * exporter->height;
+    pack_rows(exporter, frame, exporter->scratch);
+
+    char header[64];
+    int header_len = 0;
+    uint8_t* body = exporter->scratch;
+    size_t body_len = rows_len;
+    if (exporter->format == EXPORT_PPM) {
+        header_len = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", exporter->width, exporter->height);
+    } else if (exporter->format == EXPORT_PNG) {
+        body_len = encode_png(exporter, rows_len, &body);
+    }
+
+    bool to_stdout = strcmp(exporter->path, "-") == 0;
+    FILE* file = stdout;
+    if (!to_stdout) {
+        char name[MAX_FRAME_PATH];
+        snprintf(name, sizeof(name), exporter->path, exporter->frames_written);
+        file = fopen(name, "wb");
+        if (file == NULL) {
+            fprintf(stderr, "could not create frame: %s\n", name);
+            return false;
+        }
+    }
+    bool ok = fwrite(header, 1, header_len, file) == (size_t)header_len &&
+              fwrite(body, 1, body_len, file) == body_len;
+    if (!to_stdout && fclose(file) != 0) {
+        ok = false;
+    }
+    exporter->frames_written++;
+    return ok;
+}
+
+static void* encoder_thread(void* arg) {
+    struct Exporter* exporter = arg;
+    while (true) {
+        pthread_mutex_lock(&exporter->lock);
+        while (exporter->count == 0 && !exporter->finished) {
+            pthread_cond_wait(&exporter->not_empty, &exporter->lock);
+        }
+        if (exporter->count == 0) {
+            pthread_mutex_unlock(&exporter->lock);
+            break;
+        }
+        // the producer does not touch queued frames, so the lock is not
+        // held while encoding
+        const struct Raster* frame = &exporter->frames[exporter->head];
+        pthread_mutex_unlock(&exporter->lock);
+
+        if (!exporter->error && !write_frame(exporter, frame)) {
+            exporter->error = true;
+        }
+
+        pthread_mutex_lock(&exporter->lock);
+        exporter->head = (exporter->head + 1) % EXPORT_QUEUE_LEN;
+        exporter->count--;
+        pthread_cond_signal(&exporter->not_full);
+        pthread_mutex_unlock(&exporter->lock);
+    }
+    return NULL;
+}
+
+static void free_frames(struct Exporter* exporter) {
+    for (int i = 0; i < EXPORT_QUEUE_LEN; i++) {
+        raster_free(&exporter->frames[i]);
+    }
+    free(exporter->scratch);
+    exporter->scratch = NULL;
+}
+
+bool exporter_init(struct Exporter* exporter, enum ExportFormat format, const char* path, int width, int height) {
+    pthread_once(&crc_table_once, init_crc_table);
+    memset(exporter, 0, sizeof(*exporter));
+    exporter->format = format;
+    exporter->path = path;
+    exporter->width = width;
+    exporter->height = height;
+
+    bool ok = true;
+    for (int i = 0; i < EXPORT_QUEUE_LEN; i++) {
+        ok = ok && raster_init(&exporter->frames[i], width, height);
+    }
+    exporter->scratch_size = scratch_size(exporter);
+    exporter->scratch = ok ? malloc(exporter->scratch_size) : NULL;
+    if (exporter->scratch == NULL) {
+        free_frames(exporter);
+        return false;
+    }
+
+    pthread_mutex_init(&exporter->lock, NULL);
+    pthread_cond_init(&exporter->not_empty, NULL);
+    pthread_cond_init(&exporter->not_full, NULL);
+    if (pthread_create(&exporter->thread, NULL, encoder_thread, exporter) != 0) {
+        pthread_mutex_destroy(&exporter->lock);
+        pthread_cond_destroy(&exporter->not_empty);
+        pthread_cond_destroy(&exporter->not_full);
+        free_frames(exporter);
+        return false;
+    }
+    return true;
+}
+
+struct Raster* exporter_acquire(struct Exporter* exporter) {
+    pthread_mutex_lock(&exporter->lock);
+    while (exporter->count == EXPORT_QUEUE_LEN) {
+        pthread_cond_wait(&exporter->not_full, &exporter->lock);
+    }
+    // the slot after the queued frames stays free until exporter_submit
+    struct Raster* frame = &exporter->frames[(exporter->head + exporter->count) % EXPORT_QUEUE_LEN];
+    pthread_mutex_unlock(&exporter->lock);
+    return frame;
+}
+
+void exporter_submit(struct Exporter* exporter) {
+    pthread_mutex_lock(&exporter->lock);
+    exporter->count++;
+    pthread_cond_signal(&exporter->not_empty);
+    pthread_mutex_unlock(&exporter->lock);
+}
+
+bool exporter_finish(struct Exporter* exporter) {
+    pthread_mutex_lock(&exporter->lock);
+    exporter->finished = true;
+    pthread_cond_signal(&exporter->not_empty);
+    pthread_mutex_unlock(&exporter->lock);
+    pthread_join(exporter->thread, NULL);
+
+    if (strcmp(exporter->path, "-") == 0 && fflush(stdout) != 0) {
+        exporter->error = true;
+    }
+    pthread_mutex_destroy(&exporter->lock);
+    pthread_cond_destroy(&exporter->not_empty);
+    pthread_cond_destroy(&exporter->not_full);
+    free_frames(exporter);
+    return !exporter->error;
+}
+
+// ================== Frames ==================
+bool export_run(struct Exporter* exporter,
+                struct Engine* engine,
+                int* values,
+                int len,
+                long long steps_per_frame) {
+    // the same chart as the visualizer, more elements than pixel columns
+    // are drawn as bucket envelopes
+    struct ColumnLod lod;
+    bool lod_enabled = len > exporter->width;
+    if (lod_enabled && !column_lod_init(&lod, values, len, exporter->width)) {
+        return false;
+    }
+    int num_columns = lod_enabled ? lod.num_buckets : len;
+    int* highlight_map = malloc(num_columns * sizeof(int));
+    if (highlight_map == NULL) {
+        if (lod_enabled) {
+            column_lod_free(&lod);
+        }
+        return false;
+    }
+    for (int i = 0; i < num_columns; i++) {
+        highlight_map[i] = -1;
+    }
+
+    int indices[MAX_HIGHLIGHTS];
+    Color_t colors[MAX_HIGHLIGHTS];
+    struct ColumnDrawData data = {
+        .x = 0,
+        .y = exporter->height,
+        .w = exporter->width / num_columns,
+        .num_columns = num_columns,
+        .num_colored_columns = 0,
+        .columns = lod_enabled ? lod.bucket_max : values,
+        .colored_columns_indices = indices,
+        .colors = colors,
+        .column_min = lod_enabled ? lod.bucket_min : NULL,
+        .column_mean = lod_enabled ? lod.bucket_mean : NULL,
+    };
+    if (lod_enabled) {
+        engine_set_write_log(engine, &lod.write_log);
+    }
+
+    while (true) {
+        if (lod_enabled) {
+            column_lod_update(&lod, NULL);
+        }
+        struct Highlight highlights[MAX_HIGHLIGHTS];
+        int n = engine_highlights(engine, highlights);
+        for (int k = 0; k < n; k++) {
+            indices[k] = highlights[k].idx;
+            if (lod_enabled && indices[k] >= 0 && indices[k] < len) {
+                indices[k] = column_lod_bucket(&lod, indices[k]);
+            }
+            colors[k] = highlight_color(highlights[k]);
+        }
+        data.num_colored_columns = n;
+
+        struct Raster* frame = exporter_acquire(exporter);
+        raster_columns(frame, &data, highlight_map);
+        const int* counts;
+        int active;
+        int num_buckets = engine_histogram(engine, &counts, &active);
+        if (num_buckets > 0) {
+            raster_histogram(frame, counts, num_buckets, active, 0, 0, exporter->width,
+                             exporter->height / COLUMN_HEADROOM);
+        }
+        exporter_submit(exporter);
+
+        if (engine_done(engine)) {
+            break;
+        }
+        engine_step_n(engine, steps_per_frame);
+    }
+
+    if (lod_enabled) {
+        engine_set_write_log(engine, NULL);
+        column_lod_free(&lod);
+    }
+    free(highlight_map);
+    return true;
+}
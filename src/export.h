@@ -0,0 +1,73 @@
+#pragma once
+
+#include "engine.h"
+#include "raster.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Offline export of a run as a sequence of frames, rasterized with the same
+// chart as the visualizer and without opening a window. Frames are encoded on
+// a thread of their own while the next ones are stepped and drawn, a bounded
+// queue of EXPORT_QUEUE_LEN frames stops the stepping when the encoder falls
+// behind.
+//
+// The frames go either to one file per frame (the path is a printf pattern
+// with a single integer conversion, e.g. frames/%06d.png) or, with the path
+// "-", to stdout one after the other, ready to be piped into an encoder:
+//   headless --export - --format raw --width 1280 --height 720 |
+//       ffmpeg -f rawvideo -pixel_format rgba -video_size 1280x720 -i - out.mp4
+
+enum ExportFormat {
+    EXPORT_PPM, // binary P6
+    EXPORT_PNG, // RGB, deflated with fixed Huffman codes
+    EXPORT_RAW, // RGBA bytes without a header
+    NUM_EXPORT_FORMATS,
+};
+
+#define EXPORT_QUEUE_LEN 8
+
+const char* export_format_name(enum ExportFormat format);
+bool parse_export_format(const char* name, enum ExportFormat* format);
+// returns true if path is "-" or a pattern export can use
+bool export_path_valid(const char* path);
+
+struct Exporter {
+    enum ExportFormat format;
+    const char* path;
+    int width;
+    int height;
+    struct Raster frames[EXPORT_QUEUE_LEN];
+    int head;  // next frame to encode
+    int count; // frames waiting to be encoded
+    bool finished;
+    bool error; // a frame could not be written
+    int frames_written;
+    uint8_t* scratch; // encoder output, owned by the encoder thread
+    size_t scratch_size;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+// start the encoder thread, returns false if the frames could not be
+// allocated or the thread not started
+bool exporter_init(struct Exporter* exporter, enum ExportFormat format, const char* path, int width, int height);
+// the raster to draw the next frame into, blocks while the queue is full
+struct Raster* exporter_acquire(struct Exporter* exporter);
+// queue the frame returned by the last exporter_acquire
+void exporter_submit(struct Exporter* exporter);
+// wait for the queued frames to be written and stop the encoder thread,
+// returns false if any frame could not be written
+bool exporter_finish(struct Exporter* exporter);
+
+// run engine, freshly initialized on values, to completion and export a
+// frame of the chart every steps_per_frame steps, including the first and
+// the last state, returns false on errors
+bool export_run(struct Exporter* exporter,
+                struct Engine* engine,
+                int* values,
+                int len,
+                long long steps_per_frame);
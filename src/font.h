@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// 5x7 bitmap font for text drawn without a font library (HUD and exported
+// frames). Covers digits, upper case letters and the punctuation used by the
+// overlays, lower case letters are drawn as upper case and anything else as
+// a blank.
+
+#define FONT_WIDTH 5
+#define FONT_HEIGHT 7
+// horizontal and vertical distance between characters at scale 1
+#define FONT_ADVANCE (FONT_WIDTH + 1)
+#define FONT_LINE_HEIGHT (FONT_HEIGHT + 2)
+
+// FONT_HEIGHT rows from top to bottom, bit FONT_WIDTH - 1 of each row is the
+// leftmost pixel
+const uint8_t* font_glyph(char c);
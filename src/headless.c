@@ -0,0 +1,169 @@
+#include "config.h"
+#include "datagen.h"
+#include "engine.h"
+#include "export.h"
+#include "raster.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Runs a sort to completion without opening a window, as fast as the
+// step engine allows. Takes the same options as the visualizer, the window
+// options are ignored. With --record FILE every step is written to a trace,
+// which is slower than running the steps alone. With --export PATH a frame
+// of the --width x --height chart is written every --steps steps instead.
+// --counters FILE writes the work counted by the algorithm as JSON, with
+// --timing 1 including a histogram of the step latencies.
+
+#define VALUE_MIN 20
+#define VALUE_MAX 400
+
+static bool is_sorted(const int* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        if (arr[i - 1] > arr[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// counters of the finished run as a single JSON object, latency[b] is the
+// number of steps that took [2^b, 2^(b+1)) cycles, trailing zeros left out
+static bool write_counters(const char* path, FILE* out, const struct Config* config, const struct Engine* engine) {
+    FILE* file = strcmp(path, "-") == 0 ? out : fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    struct Counters counters = engine_counters(engine);
+    fprintf(file,
+            "{\"algorithm\": \"%s\", \"distribution\": \"%s\", \"elements\": %d, \"steps\": %lld, "
+            "\"comparisons\": %lld, \"writes\": %lld, \"swaps\": %lld, \"allocations\": %lld, "
+            "\"aux_bytes_peak\": %lld",
+            algorithm_name(config->algorithm),
+            distribution_name(config->distribution),
+            config->num_elements,
+            engine->steps,
+            counters.comparisons,
+            counters.writes,
+            counters.swaps,
+            counters.allocations,
+            counters.aux_bytes_peak);
+    if (engine->timing) {
+        int num_buckets = ENGINE_LATENCY_BUCKETS;
+        while (num_buckets > 0 && engine->latency[num_buckets - 1] == 0) {
+            num_buckets--;
+        }
+        fprintf(file, ", \"step_latency_log2\": [");
+        for (int b = 0; b < num_buckets; b++) {
+            fprintf(file, b == 0 ? "%lld" : ", %lld", engine->latency[b]);
+        }
+        fprintf(file, "]");
+    }
+    fprintf(file, "}\n");
+    bool ok = !ferror(file);
+    if (file != out) {
+        ok = fclose(file) == 0 && ok;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    struct Config config;
+    config_init(&config);
+    config.algorithm = MERGE_SORT;
+    config.num_elements = 10000;
+    if (!config_parse_args(&config, argc, argv)) {
+        config_print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int len = config.num_elements;
+    int* arr = malloc(len * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "could not allocate %d elements\n", len);
+        return EXIT_FAILURE;
+    }
+    bool exporting = config.export_path[0] != '\0';
+    if (exporting) {
+        // the same range of values as the visualizer, which fits the chart
+        int max_height = config.height - config.height / COLUMN_HEADROOM;
+        max_height = max_height > COLUMN_MIN_HEIGHT ? max_height : COLUMN_MIN_HEIGHT;
+        generate(arr, len, config.distribution, COLUMN_MIN_HEIGHT, max_height, config.seed);
+    } else {
+        generate(arr, len, config.distribution, VALUE_MIN, VALUE_MAX, config.seed);
+    }
+
+    simd_set_level(config.simd_level);
+    struct Engine engine;
+    engine_init(&engine, config.algorithm, arr, len);
+    engine_set_fast_path(&engine, config.fast_path);
+    engine_set_timing(&engine, config.timing);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long long steps;
+    int frames = 0;
+    if (config.record_path[0] != '\0') {
+        // the trace starts from the unsorted array, arr is only written by
+        // the steps after engine_init
+        if (!trace_record(&engine, arr, len, config.record_path)) {
+            fprintf(stderr, "could not write trace: %s\n", config.record_path);
+            engine_free(&engine);
+            free(arr);
+            return EXIT_FAILURE;
+        }
+        steps = engine.steps;
+    } else if (exporting) {
+        struct Exporter exporter;
+        bool ok = exporter_init(&exporter, config.export_format, config.export_path, config.width, config.height);
+        if (ok) {
+            ok = export_run(&exporter, &engine, arr, len, config.steps_per_frame);
+            ok = exporter_finish(&exporter) && ok;
+        }
+        if (!ok) {
+            fprintf(stderr, "could not export frames: %s\n", config.export_path);
+            engine_free(&engine);
+            free(arr);
+            return EXIT_FAILURE;
+        }
+        steps = engine.steps;
+        frames = exporter.frames_written;
+    } else {
+        steps = engine_run(&engine);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    bool sorted = is_sorted(arr, len);
+    // frames streamed to stdout must not be mixed with the results
+    FILE* out = exporting && strcmp(config.export_path, "-") == 0 ? stderr : stdout;
+    fprintf(out,
+            "algorithm=%s distribution=%s elements=%d simd=%s fast_path=%d steps=%lld seconds=%f "
+            "steps_per_sec=%.0f sorted=%s\n",
+            algorithm_name(config.algorithm),
+            distribution_name(config.distribution),
+            len,
+            simd_level_name(simd_level()),
+            config.fast_path,
+            steps,
+            elapsed,
+            elapsed > 0 ? steps / elapsed : 0.0,
+            sorted ? "yes" : "no");
+    if (exporting) {
+        fprintf(out,
+                "format=%s frames=%d frames_per_sec=%.0f\n",
+                export_format_name(config.export_format),
+                frames,
+                elapsed > 0 ? frames / elapsed : 0.0);
+    }
+    // the counters live in the algorithm state, which engine_free releases
+    if (config.counters_path[0] != '\0' && !write_counters(config.counters_path, out, &config, &engine)) {
+        fprintf(stderr, "could not write counters: %s\n", config.counters_path);
+    }
+
+    engine_free(&engine);
+    free(arr);
+    return sorted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
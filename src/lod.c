@@ -0,0 +1,115 @@
+#include "lod.h"
+#include <stdint.h>
+
+// element writes tracked between two updates before the whole aggregate is
+// rebuilt, a rebuild costs about as much as that many writes
+#define LOD_WRITE_LOG_CAPACITY (1 << 20)
+
+bool column_lod_init(struct ColumnLod* lod, const int* values, int len, int num_buckets) {
+    lod->values = values;
+    lod->len = len;
+    lod->num_buckets = num_buckets < len ? num_buckets : len;
+    lod->bucket_min = malloc(lod->num_buckets * sizeof(int));
+    lod->bucket_max = malloc(lod->num_buckets * sizeof(int));
+    lod->bucket_mean = malloc(lod->num_buckets * sizeof(int));
+    lod->dirty = calloc(lod->num_buckets, sizeof(bool));
+    lod->dirty_buckets = malloc(lod->num_buckets * sizeof(int));
+    lod->num_dirty = 0;
+
+    bool ok = lod->bucket_min != NULL && lod->bucket_max != NULL &&
+              lod->bucket_mean != NULL && lod->dirty != NULL &&
+              lod->dirty_buckets != NULL &&
+              write_log_init(&lod->write_log, LOD_WRITE_LOG_CAPACITY);
+    if (!ok) {
+        column_lod_free(lod);
+        return false;
+    }
+
+    column_lod_rebuild(lod);
+    return true;
+}
+
+void column_lod_free(struct ColumnLod* lod) {
+    free(lod->bucket_min);
+    free(lod->bucket_max);
+    free(lod->bucket_mean);
+    free(lod->dirty);
+    free(lod->dirty_buckets);
+    write_log_free(&lod->write_log);
+    lod->bucket_min = NULL;
+    lod->bucket_max = NULL;
+    lod->bucket_mean = NULL;
+    lod->dirty = NULL;
+    lod->dirty_buckets = NULL;
+    lod->num_buckets = 0;
+}
+
+int column_lod_bucket(const struct ColumnLod* lod, int idx) {
+    return (int)((int64_t)idx * lod->num_buckets / lod->len);
+}
+
+// first element of bucket b, the inverse of column_lod_bucket
+static int bucket_start(const struct ColumnLod* lod, int b) {
+    return (int)(((int64_t)b * lod->len + lod->num_buckets - 1) / lod->num_buckets);
+}
+
+static void compute_bucket(struct ColumnLod* lod, int b) {
+    int start = bucket_start(lod, b);
+    int end = bucket_start(lod, b + 1);
+    int min = lod->values[start];
+    int max = lod->values[start];
+    int64_t sum = 0;
+    for (int i = start; i < end; i++) {
+        int v = lod->values[i];
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+        sum += v;
+    }
+    lod->bucket_min[b] = min;
+    lod->bucket_max[b] = max;
+    lod->bucket_mean[b] = (int)(sum / (end - start));
+}
+
+void column_lod_rebuild(struct ColumnLod* lod) {
+    for (int b = 0; b < lod->num_buckets; b++) {
+        compute_bucket(lod, b);
+    }
+    write_log_clear(&lod->write_log);
+}
+
+void column_lod_update(struct ColumnLod* lod, struct WriteLog* changed) {
+    struct WriteLog* log = &lod->write_log;
+    if (log->overflow) {
+        column_lod_rebuild(lod);
+        if (changed != NULL) {
+            // report the overflow, consumers have to redraw everything
+            changed->overflow = true;
+        }
+        return;
+    }
+
+    // collect every written bucket once before recomputing any of them
+    for (int k = 0; k < log->len; k++) {
+        int b = column_lod_bucket(lod, log->indices[k]);
+        if (!lod->dirty[b]) {
+            lod->dirty[b] = true;
+            lod->dirty_buckets[lod->num_dirty++] = b;
+        }
+    }
+
+    for (int k = 0; k < lod->num_dirty; k++) {
+        int b = lod->dirty_buckets[k];
+        compute_bucket(lod, b);
+        lod->dirty[b] = false;
+        if (changed != NULL) {
+            if (changed->len < changed->capacity) {
+                changed->indices[changed->len++] = b;
+            } else {
+                changed->overflow = true;
+            }
+        }
+    }
+
+    lod->num_dirty = 0;
+    write_log_clear(log);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+
+// Level of detail for arrays with more elements than there are pixel
+// columns. The values are split into num_buckets consecutive buckets and
+// each bucket is drawn as the min/max/mean envelope of its values. Only the
+// buckets that were written to are recomputed, so a frame costs O(width)
+// plus the size of the written buckets instead of O(n).
+struct ColumnLod {
+    const int* values;
+    int len;
+    int num_buckets;
+    int* bucket_min;
+    int* bucket_max;
+    int* bucket_mean;
+    bool* dirty;
+    int* dirty_buckets;
+    int num_dirty;
+    struct WriteLog write_log; // to be filled by the active algorithm
+};
+
+bool column_lod_init(struct ColumnLod* lod, const int* values, int len, int num_buckets);
+void column_lod_free(struct ColumnLod* lod);
+
+// the bucket that holds values[idx]
+int column_lod_bucket(const struct ColumnLod* lod, int idx);
+// recompute every bucket, needed when values changed outside the write log
+void column_lod_rebuild(struct ColumnLod* lod);
+// recompute the buckets written to since the last update and record their
+// indices in changed (if not NULL), then clear the write log
+void column_lod_update(struct ColumnLod* lod, struct WriteLog* changed);
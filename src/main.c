@@ -1,118 +1,315 @@
 #include "algorithms.h"
+#include "config.h"
+#include "datagen.h"
+#include "engine.h"
+#include "font.h"
+#include "lod.h"
+#include "render.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "worker.h"
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
-#define SCREEN_WIDTH 640
-#define SCREEN_HEIGHT 480
-#define COLUMN_MAX_HEIGHT 400
-#define COLUMN_MIN_HEIGHT 20
+// position and size of the counters HUD
+#define HUD_MARGIN 8
+#define HUD_SCALE 2
 
-#define DELAY_MS 10
-
-#define NUM_COLUMNS SCREEN_WIDTH / 4 // screen with is divisable by 4
+// Command line options: see config_print_usage, e.g.
+//   main --size 100000 --dist nearly-sorted --steps 1000 --seed 7
+// With --replay FILE a trace written by `headless --record FILE` is played
+// back instead, the size and algorithm are the ones of the trace. With
+// --threaded 1 the sort runs on a worker thread, see worker.h, and the
+// window draws the latest snapshot of it every frame.
 
 // Keyboard controls
 // -- R:     reset
 // -- SPACE: start/stop
 // -- S:     step
+// -- UP:    double the steps per frame
+// -- DOWN:  halve the steps per frame
+// -- B:     toggle budget mode (fill what the frame leaves with steps)
+// -- T:     toggle between the rect and the streaming texture renderer
+// -- H:     toggle the counters HUD
 // -- 1:     selection sort
 // -- 2:     insert sort
 // -- 3:     merge sort
-
-enum AlgorithmType {
-    SELECTION_SORT,
-    INSERT_SORT,
-    MERGE_SORT,
-    QUICK_SORT,
-    BUBBLE_SORT,
-};
-
-typedef struct Color {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-} Color_t;
-
-struct ColumnDrawData {
-    // coordinate system: (0, 0) is the top-left corner,
-    // x increases to the right, y increases downwards
-    int x; // x-coordinate of the first column
-    int y; // y-coordinate of the first column
-    int w; // width of a column
-    int num_columns;
-    int num_colored_columns;
-    int* columns;
-    // the color at color[i] will be applied to the column
-    // at colored_column_indices[i]
-    int* colored_columns_indices;
-    Color_t* colors;
-};
+// -- 4:     quick sort
+// -- 5:     bubble sort
+// -- 6:     intro sort
+// -- 7:     parallel merge sort, one color per worker
+// -- 8:     work-stealing quick sort, one color per worker
+// -- 9:     LSD radix sort, bucket counters drawn at the top
+// -- 0:     MSD radix sort (American flag sort)
+// -- I:     binary insertion sort
+// -- N:     natural merge sort (Timsort), runs and gallop jumps highlighted
+// When replaying a trace the algorithm keys restart it, and
+// -- D:     toggle reverse playback
+// -- LEFT:  step backwards
+// -- RIGHT: step
+// -- HOME:  jump to the start
+// -- END:   jump to the end
 
 struct App {
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Event event;
+    struct Config config;
     enum AlgorithmType algorithm_type;
-    struct SelectionSortState selection_sort_state;
-    struct InsertSortState insert_sort_state;
-    struct MergeSortState merge_sort_state;
+    struct Engine engine;
+    // with --replay the trace drives values instead of the engine
+    struct TracePlayer player;
+    bool replaying;
+    bool reverse; // play the trace backwards
+    // with --threaded the worker drives values instead of the engine
+    struct SortWorker worker;
+    bool threaded;
+    long long generation;            // resets sent to the worker
+    const struct Snapshot* snapshot; // of the current generation, NULL if none yet
+    long long snapshot_steps;        // steps of the last snapshot taken
+    struct WriteLog* write_log;      // where the changes of a snapshot are logged
     struct ColumnDrawData draw_info;
-
-    int rnd_values[NUM_COLUMNS];
+    struct ColumnRenderer column_renderer;
+    // with more elements than pixel columns the chart shows the min/max
+    // envelope of buckets of elements instead of single elements
+    struct ColumnLod lod;
+    bool lod_enabled;
+
+    int* values; // config.num_elements values being sorted
+    int num_resets;
+    int highlight_indices[MAX_HIGHLIGHTS];
+    Color_t highlight_colors[MAX_HIGHLIGHTS];
+    int steps_per_frame;
+    bool budget_mode;
     bool running;
+    bool should_step; // take a single step in the next frame
+    bool show_hud;
+    bool quit;
+    struct FrameScheduler scheduler;
 };
 
-const Color_t PRIMARY = {4, 191, 157, 255};
-const Color_t SECONDARY = {210, 64, 31, 255};
-const Color_t TERTIARY = {200, 180, 60, 255};
-const Color_t LIGHT = {220, 220, 220, 255};
-const Color_t DARK = {6, 10, 18, 255};
-
-void draw_columns(SDL_Renderer* const renderer, struct ColumnDrawData data) {
-    for (int i = 0; i < data.num_columns; i++) {
-        SDL_Rect column =
-            {data.x + i * data.w, data.y, data.w, -data.columns[i]};
-        Color_t color = LIGHT;
-        for (int j = 0; j < data.num_colored_columns; j++) {
-            if (i == data.colored_columns_indices[j]) {
-                color = data.colors[j];
-                break;
-            }
-        }
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-        SDL_RenderFillRect(renderer, &column);
-        SDL_SetRenderDrawColor(renderer, DARK.r, DARK.g, DARK.b, DARK.a);
-    }
-}
-
 void column_draw_data_init(struct ColumnDrawData* data,
+                           const struct Config* config,
                            int* columns,
                            int num_columns) {
     data->x = 0;
-    data->y = SCREEN_HEIGHT;
-    data->w = SCREEN_WIDTH / num_columns;
+    data->y = config->height;
+    data->w = config->width / num_columns;
     data->num_columns = num_columns;
     data->columns = columns;
     data->num_colored_columns = 0;
     data->colored_columns_indices = NULL;
     data->colors = NULL;
+    data->column_min = NULL;
+    data->column_mean = NULL;
+}
+
+// the streaming backend only redraws the columns the algorithm wrote to,
+// so the algorithm has to log its writes while it is active
+void set_render_backend(struct App* app, enum RenderBackend backend) {
+    struct ColumnRenderer* column_renderer = &app->column_renderer;
+    if (backend == BACKEND_STREAMING && column_renderer->texture == NULL) {
+        backend = BACKEND_RECTS;
+    }
+
+    column_renderer->backend = backend;
+    column_renderer_invalidate(column_renderer);
+    write_log_clear(&column_renderer->write_log);
+    // the aggregate is kept up to date through the write log regardless of
+    // the backend, it forwards changed buckets to the streaming one
+    struct WriteLog* log = app->lod_enabled              ? &app->lod.write_log
+                           : backend == BACKEND_STREAMING ? &column_renderer->write_log
+                                                          : NULL;
+    app->write_log = log;
+    if (app->replaying) {
+        trace_player_set_write_log(&app->player, log);
+    } else {
+        engine_set_write_log(&app->engine, log);
+    }
+}
+
+// largest value generated for the chart
+int max_value(const struct Config* config) {
+    int max_height = config->height - config->height / COLUMN_HEADROOM;
+    return max_height > COLUMN_MIN_HEIGHT ? max_height : COLUMN_MIN_HEIGHT;
+}
+
+// returns false if the command was dropped
+bool send_command(struct App* app, struct WorkerCommand command) {
+    if (!sort_worker_send(&app->worker, command)) {
+        fprintf(stderr, "worker command queue is full, command dropped\n");
+        return false;
+    }
+    return true;
+}
+
+// steps per second the worker runs at, the same speed as stepping on the
+// main thread, no limit in budget mode
+void send_rate(struct App* app) {
+    double fps = 1000.0 / app->scheduler.frame_ms;
+    double rate = app->budget_mode ? 0.0 : app->steps_per_frame * fps;
+    send_command(app, (struct WorkerCommand){.type = WORKER_SET_RATE, .rate = rate});
 }
 
 // reset app to initial state
 void reset(struct App* app) {
-    for (int i = 0; i < NUM_COLUMNS; i++) {
-        app->rnd_values[i] =
-            rand() % (COLUMN_MAX_HEIGHT - COLUMN_MIN_HEIGHT + 2) +
-            COLUMN_MIN_HEIGHT;
+    // every reset draws a new array, but the sequence of arrays is the
+    // same for the same seed
+    const struct Config* config = &app->config;
+    if (app->replaying) {
+        // a trace always starts from the array it was recorded with
+        trace_player_seek(&app->player, 0);
+    } else {
+        uint64_t seed = config->seed + app->num_resets;
+        if (app->threaded) {
+            // the worker generates the same array, values are only drawn
+            // again once its snapshots of the new run arrive, a dropped
+            // reset leaves the current run as it is
+            struct WorkerCommand command = {.type = WORKER_RESET, .algorithm = app->algorithm_type, .seed = seed};
+            if (!send_command(app, command)) {
+                return;
+            }
+            app->generation++;
+            app->snapshot = NULL;
+        }
+        app->num_resets++;
+        generate(app->values, config->num_elements, config->distribution, COLUMN_MIN_HEIGHT, max_value(config), seed);
     }
 
     app->running = false;
-    column_draw_data_init(&app->draw_info, app->rnd_values, NUM_COLUMNS);
-    selection_sort_init(&app->selection_sort_state, app->rnd_values, NUM_COLUMNS);
-    insert_sort_init(&app->insert_sort_state, app->rnd_values, NUM_COLUMNS);
-    merge_sort_init(&app->merge_sort_state, app->rnd_values, NUM_COLUMNS);
+    if (app->lod_enabled) {
+        column_lod_rebuild(&app->lod);
+        column_draw_data_init(&app->draw_info, config, app->lod.bucket_max, app->lod.num_buckets);
+        app->draw_info.column_min = app->lod.bucket_min;
+        app->draw_info.column_mean = app->lod.bucket_mean;
+    } else {
+        column_draw_data_init(&app->draw_info, config, app->values, config->num_elements);
+    }
+    if (!app->replaying && !app->threaded) {
+        engine_free(&app->engine);
+        engine_init(&app->engine, app->algorithm_type, app->values, config->num_elements);
+        engine_set_fast_path(&app->engine, config->fast_path);
+    }
+    set_render_backend(app, app->column_renderer.backend);
+}
+
+// point the draw data at the columns the active algorithm is working on
+void set_highlights(struct App* app) {
+    struct Engine* engine = &app->engine;
+    int* ind = app->highlight_indices;
+    Color_t* colors = app->highlight_colors;
+
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int n = 0;
+    if (app->threaded) {
+        if (app->snapshot != NULL) {
+            n = app->snapshot->num_highlights;
+            memcpy(highlights, app->snapshot->highlights, n * sizeof(*highlights));
+        }
+    } else {
+        n = app->replaying ? trace_player_highlights(&app->player, highlights) : engine_highlights(engine, highlights);
+    }
+    for (int k = 0; k < n; k++) {
+        ind[k] = highlights[k].idx;
+        colors[k] = highlight_color(highlights[k]);
+    }
+
+    if (app->lod_enabled) {
+        // highlight the buckets that hold the highlighted elements
+        for (int k = 0; k < n; k++) {
+            if (ind[k] >= 0 && ind[k] < app->config.num_elements) {
+                ind[k] = column_lod_bucket(&app->lod, ind[k]);
+            }
+        }
+    }
+
+    app->draw_info.num_colored_columns = n;
+    app->draw_info.colored_columns_indices = ind;
+    app->draw_info.colors = colors;
+}
+
+// the step and work counters of the active algorithm in the top-left corner,
+// a trace only knows its steps and comparisons, followed by the frame metrics
+void draw_hud(struct App* app) {
+    char text[512];
+    int len;
+    if (app->replaying) {
+        len = snprintf(text,
+                       sizeof(text),
+                       "%s\nstep %lld/%lld\ncmp  %lld",
+                       algorithm_name(app->player.algorithm),
+                       trace_player_step(&app->player),
+                       app->player.total_steps,
+                       trace_player_comparisons(&app->player));
+    } else {
+        struct Counters counters = engine_counters(&app->engine);
+        long long steps = app->engine.steps;
+        if (app->threaded) {
+            counters = app->snapshot != NULL ? app->snapshot->counters : (struct Counters){0};
+            steps = app->snapshot != NULL ? app->snapshot->steps : 0;
+        }
+        len = snprintf(text,
+                       sizeof(text),
+                       "%s\nsteps %lld\ncmp   %lld\nwr    %lld\nswp   %lld\nalloc %lld\naux   %lld/%lld kb",
+                       algorithm_name(app->algorithm_type),
+                       steps,
+                       counters.comparisons,
+                       counters.writes,
+                       counters.swaps,
+                       counters.allocations,
+                       counters.aux_bytes / 1024,
+                       counters.aux_bytes_peak / 1024);
+    }
+    const struct FrameScheduler* scheduler = &app->scheduler;
+    snprintf(text + len,
+             sizeof(text) - len,
+             "\n\nfps   %.0f%s\nframe %.1f ms\nstep/s %.0f\ndrop  %lld",
+             scheduler->fps,
+             scheduler->vsync ? " vsync" : "",
+             scheduler->frame_time_ms,
+             scheduler->steps_per_sec,
+             scheduler->dropped_frames);
+
+    // size of the text block, for the background
+    int lines = 1;
+    int columns = 0;
+    int line_len = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            lines++;
+            line_len = 0;
+        } else if (++line_len > columns) {
+            columns = line_len;
+        }
+    }
+    SDL_Rect box = {HUD_MARGIN,
+                    HUD_MARGIN,
+                    (columns * FONT_ADVANCE + 2) * HUD_SCALE,
+                    (lines * FONT_LINE_HEIGHT + 2) * HUD_SCALE};
+    SDL_SetRenderDrawColor(app->renderer, DARK.r, DARK.g, DARK.b, DARK.a);
+    SDL_RenderFillRect(app->renderer, &box);
+    draw_text(app->renderer, box.x + 2 * HUD_SCALE, box.y + 2 * HUD_SCALE, HUD_SCALE, text, LIGHT);
+}
+
+// the histogram of radix sorts fills the headroom above the columns
+void draw_overlay(struct App* app) {
+    const int* counts;
+    int active;
+    int num_buckets = engine_histogram(&app->engine, &counts, &active);
+    if (app->threaded) {
+        num_buckets = app->snapshot != NULL ? app->snapshot->num_buckets : 0;
+        counts = app->snapshot != NULL ? app->snapshot->histogram : NULL;
+        active = app->snapshot != NULL ? app->snapshot->active_bucket : -1;
+    }
+    if (num_buckets > 0) {
+        SDL_Rect area = {0, 0, app->config.width, app->config.height / COLUMN_HEADROOM};
+        draw_histogram(app->renderer, counts, num_buckets, active, area);
+    }
+    if (app->show_hud) {
+        draw_hud(app);
+    }
 }
 
 // initializes SDL2 and create a window among other things
@@ -123,8 +320,16 @@ bool init(struct App* app) {
         return false;
     }
 
-    if (SDL_CreateWindowAndRenderer(SCREEN_WIDTH,
-                                    SCREEN_HEIGHT,
+    const struct Config* config = &app->config;
+    app->values = app->replaying ? app->player.values : malloc(config->num_elements * sizeof(int));
+    if (app->values == NULL) {
+        fprintf(stderr, "could not allocate %d elements\n", config->num_elements);
+        return false;
+    }
+
+    SDL_SetHint(SDL_HINT_RENDER_VSYNC, config->vsync ? "1" : "0");
+    if (SDL_CreateWindowAndRenderer(config->width,
+                                    config->height,
                                     0,
                                     &app->window,
                                     &app->renderer) < 0) {
@@ -136,122 +341,303 @@ bool init(struct App* app) {
     SDL_RenderClear(app->renderer);
     SDL_RenderPresent(app->renderer);
 
-    app->algorithm_type = SELECTION_SORT;
+    // the hint is only a request, pace the frames ourselves if the renderer
+    // did not get vsync
+    SDL_RendererInfo info;
+    bool vsync = config->vsync && SDL_GetRendererInfo(app->renderer, &info) == 0 &&
+                 (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+    SDL_DisplayMode mode;
+    int refresh_rate = SDL_GetWindowDisplayMode(app->window, &mode) == 0 && mode.refresh_rate > 0
+                           ? mode.refresh_rate
+                           : config->fps;
+    if (config->vsync && !vsync) {
+        fprintf(stderr, "vsync is not available, pacing to %d fps\n", config->fps);
+    }
+    frame_scheduler_init(&app->scheduler, vsync ? refresh_rate : config->fps, vsync);
+
+    app->threaded = config->threaded && !app->replaying;
+    if (app->threaded &&
+        !sort_worker_start(&app->worker,
+                           config->num_elements,
+                           config->distribution,
+                           COLUMN_MIN_HEIGHT,
+                           max_value(config),
+                           config->fast_path)) {
+        fprintf(stderr, "could not start the worker thread\n");
+        return false;
+    }
+
+    simd_set_level(config->simd_level);
+    app->algorithm_type = config->algorithm;
+    app->steps_per_frame = config->steps_per_frame;
+    app->budget_mode = false;
+    app->show_hud = true;
+    app->num_resets = 0;
+
+    app->lod_enabled = config->num_elements > config->width;
+    if (app->lod_enabled && !column_lod_init(&app->lod, app->values, config->num_elements, config->width)) {
+        fprintf(stderr, "could not allocate level of detail buckets\n");
+        return false;
+    }
+
+    int num_columns = app->lod_enabled ? app->lod.num_buckets : config->num_elements;
+    if (!column_renderer_init(&app->column_renderer, num_columns)) {
+        fprintf(stderr, "could not allocate column renderer\n");
+        return false;
+    }
+    if (!column_renderer_init_streaming(&app->column_renderer,
+                                        app->renderer,
+                                        config->width,
+                                        config->height)) {
+        // not fatal, the rect backend is always available
+        fprintf(stderr, "could not create streaming texture: %s\n", SDL_GetError());
+    }
 
     reset(app);
+    if (app->threaded) {
+        send_rate(app);
+    }
 
     return true;
 }
 
-int main() {
-    struct App app;
+// take the latest snapshot of the worker and bring values up to date with
+// it, returns the number of steps since the last one
+long long sync_worker(struct App* app) {
+    bool fresh;
+    const struct Snapshot* snapshot = sort_worker_snapshot(&app->worker, &fresh);
+    // snapshots of runs before the last reset are dropped, the previous one
+    // belongs to the worker again and must not be read anymore
+    if (!fresh || snapshot->generation != app->generation) {
+        return 0;
+    }
+    long long steps = snapshot->steps - (app->snapshot != NULL ? app->snapshot_steps : 0);
+    snapshot_apply(snapshot, app->values, app->config.num_elements, app->write_log);
+    app->snapshot = snapshot;
+    app->snapshot_steps = snapshot->steps;
+    return steps;
+}
+
+// move the trace by steps in the current direction
+void replay_steps(struct App* app, long long steps) {
+    long long step = trace_player_step(&app->player);
+    trace_player_seek(&app->player, app->reverse ? step - steps : step + steps);
+}
 
-    if (!init(&app)) {
-        return EXIT_FAILURE;
+// apply a key press
+void handle_key(struct App* app, SDL_Keycode key) {
+    switch (key) {
+    case SDLK_r:
+        reset(app);
+        break;
+    case SDLK_1:
+        app->algorithm_type = SELECTION_SORT;
+        reset(app);
+        break;
+    case SDLK_2:
+        app->algorithm_type = INSERT_SORT;
+        reset(app);
+        break;
+    case SDLK_3:
+        app->algorithm_type = MERGE_SORT;
+        reset(app);
+        break;
+    case SDLK_4:
+        app->algorithm_type = QUICK_SORT;
+        reset(app);
+        break;
+    case SDLK_5:
+        app->algorithm_type = BUBBLE_SORT;
+        reset(app);
+        break;
+    case SDLK_6:
+        app->algorithm_type = INTRO_SORT;
+        reset(app);
+        break;
+    case SDLK_7:
+        app->algorithm_type = PARALLEL_MERGE_SORT;
+        reset(app);
+        break;
+    case SDLK_8:
+        app->algorithm_type = PARALLEL_QUICK_SORT;
+        reset(app);
+        break;
+    case SDLK_9:
+        app->algorithm_type = RADIX_LSD_SORT;
+        reset(app);
+        break;
+    case SDLK_0:
+        app->algorithm_type = RADIX_MSD_SORT;
+        reset(app);
+        break;
+    case SDLK_i:
+        app->algorithm_type = BINARY_INSERT_SORT;
+        reset(app);
+        break;
+    case SDLK_n:
+        app->algorithm_type = TIM_SORT;
+        reset(app);
+        break;
+    case SDLK_SPACE:
+        app->running = !app->running;
+        if (app->threaded) {
+            send_command(app, (struct WorkerCommand){.type = app->running ? WORKER_RUN : WORKER_PAUSE});
+        }
+        break;
+    case SDLK_s:
+        app->running = false;
+        if (app->threaded) {
+            send_command(app, (struct WorkerCommand){.type = WORKER_STEP});
+        } else {
+            app->should_step = true;
+        }
+        break;
+    case SDLK_UP:
+        if (app->steps_per_frame < MAX_STEPS_PER_FRAME) {
+            app->steps_per_frame *= 2;
+        }
+        if (app->threaded) {
+            send_rate(app);
+        }
+        break;
+    case SDLK_DOWN:
+        if (app->steps_per_frame > 1) {
+            app->steps_per_frame /= 2;
+        }
+        if (app->threaded) {
+            send_rate(app);
+        }
+        break;
+    case SDLK_d:
+        app->reverse = !app->reverse;
+        break;
+    case SDLK_LEFT:
+    case SDLK_RIGHT:
+        if (app->replaying) {
+            app->running = false;
+            long long step = trace_player_step(&app->player);
+            int delta = key == SDLK_LEFT ? -1 : 1;
+            trace_player_seek(&app->player, step + delta);
+        }
+        break;
+    case SDLK_HOME:
+        if (app->replaying) {
+            trace_player_seek(&app->player, 0);
+        }
+        break;
+    case SDLK_END:
+        if (app->replaying) {
+            trace_player_seek(&app->player, app->player.total_steps);
+        }
+        break;
+    case SDLK_b:
+        app->budget_mode = !app->budget_mode;
+        if (app->threaded) {
+            send_rate(app);
+        }
+        break;
+    case SDLK_h:
+        app->show_hud = !app->show_hud;
+        break;
+    case SDLK_t:
+        set_render_backend(app, app->column_renderer.backend == BACKEND_RECTS ? BACKEND_STREAMING : BACKEND_RECTS);
+        break;
+    default:
+        break;
     }
+}
 
-    bool should_step = false;
+// handle every pending event, so input never waits behind a slow frame
+void handle_events(struct App* app) {
+    while (SDL_PollEvent(&app->event)) {
+        if (app->event.type == SDL_QUIT) {
+            app->quit = true;
+        } else if (app->event.type == SDL_KEYDOWN) {
+            handle_key(app, app->event.key.keysym.sym);
+        }
+    }
+}
 
-    // --- Main loop ---
-    while (true) {
-        if (app.running || should_step) {
-            should_step = false;
-            switch (app.algorithm_type) {
-            case SELECTION_SORT:
-                if (!app.selection_sort_state.done) {
-                    selection_sort_step(&app.selection_sort_state);
-                }
-
-                {
-                    Color_t colors[] = {PRIMARY, SECONDARY, TERTIARY};
-                    int ind[] = {app.selection_sort_state.iter_idx,
-                                 app.selection_sort_state.inner_idx,
-                                 app.selection_sort_state.min_idx};
-                    app.draw_info.num_colored_columns = 3;
-                    app.draw_info.colored_columns_indices = ind;
-                    app.draw_info.colors = colors;
-                    break;
-                }
-            case INSERT_SORT:
-                if (!app.insert_sort_state.done) {
-                    insert_sort_step(&app.insert_sort_state);
-                }
-
-                {
-                    Color_t colors[] = {PRIMARY, SECONDARY};
-                    int ind[] = {app.insert_sort_state.iter_idx + 1,
-                                 app.insert_sort_state.insert_idx};
-                    app.draw_info.num_colored_columns = 2;
-                    app.draw_info.colored_columns_indices = ind;
-                    app.draw_info.colors = colors;
-                    break;
-                }
-            case MERGE_SORT:
-                if (!app.merge_sort_state.done) {
-                    merge_sort_step(&app.merge_sort_state);
-                }
-
-                {
-                    Color_t colors[] = {SECONDARY, SECONDARY, TERTIARY, PRIMARY, PRIMARY};
-                    int left_idx = app.merge_sort_state.merge_left_idx;
-                    int right_idx = app.merge_sort_state.merge_right_idx;
-                    int mid = left_idx + (right_idx - left_idx) / 2;
-                    int a_ind = left_idx + app.merge_sort_state.subarr_left_idx;
-                    int b_ind = mid + app.merge_sort_state.subarr_right_idx + 1;
-                    int i = left_idx + app.merge_sort_state.merge_iter;
-                    int ind[] = {a_ind, b_ind, i, left_idx, right_idx};
-                    app.draw_info.num_colored_columns = 5;
-                    app.draw_info.colored_columns_indices = ind;
-                    app.draw_info.colors = colors;
-                    break;
-                }
-            default:
-                break;
-            }
+int main(int argc, char** argv) {
+    // zero initialized so that the first reset() has nothing to free
+    struct App app = {0};
+
+    config_init(&app.config);
+    if (!config_parse_args(&app.config, argc, argv)) {
+        config_print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (app.config.replay_path[0] != '\0') {
+        if (!trace_player_open(&app.player, app.config.replay_path, app.config.trace_mmap)) {
+            return EXIT_FAILURE;
         }
+        app.replaying = true;
+        app.config.num_elements = app.player.len;
+        app.config.algorithm = app.player.algorithm;
+    }
 
-        SDL_RenderClear(app.renderer);
-        draw_columns(app.renderer, app.draw_info);
-        SDL_RenderPresent(app.renderer);
+    if (!init(&app)) {
+        return EXIT_FAILURE;
+    }
 
-        if (SDL_PollEvent(&app.event)) {
-            if (app.event.type == SDL_QUIT) {
-                break;
-            }
+    // --- Main loop ---
+    while (!app.quit) {
+        struct FrameScheduler* scheduler = &app.scheduler;
+        frame_scheduler_begin(scheduler);
+        handle_events(&app);
+        if (app.quit) {
+            break;
+        }
 
-            if (app.event.type == SDL_KEYDOWN) {
-                switch (app.event.key.keysym.sym) {
-                case SDLK_r:
-                    reset(&app);
-                    break;
-                case SDLK_1:
-                    app.algorithm_type = SELECTION_SORT;
-                    reset(&app);
-                    break;
-                case SDLK_2:
-                    app.algorithm_type = INSERT_SORT;
-                    reset(&app);
-                    break;
-                case SDLK_3:
-                    app.algorithm_type = MERGE_SORT;
-                    reset(&app);
-                    break;
-                case SDLK_SPACE:
-                    app.running = !app.running;
-                    break;
-                case SDLK_s:
-                    app.running = false;
-                    should_step = true;
-                    break;
-                default:
-                    break;
-                }
+        long long steps = 0;
+        if (app.threaded) {
+            steps = sync_worker(&app);
+        } else if (app.replaying) {
+            // budget mode has no meaning here, seeking costs far less than
+            // running the steps did
+            if (app.should_step) {
+                app.should_step = false;
+                replay_steps(&app, 1);
+            } else if (app.running) {
+                replay_steps(&app, app.steps_per_frame);
             }
+        } else if (app.should_step) {
+            app.should_step = false;
+            steps = engine_step_n(&app.engine, 1);
+        } else if (app.running && app.budget_mode) {
+            steps = engine_step_for(&app.engine, frame_scheduler_budget_ms(scheduler));
+        } else if (app.running) {
+            steps = engine_step_n(&app.engine, app.steps_per_frame);
         }
+        frame_scheduler_draw(scheduler, steps);
+        if (app.lod_enabled) {
+            struct ColumnRenderer* column_renderer = &app.column_renderer;
+            column_lod_update(&app.lod,
+                              column_renderer->backend == BACKEND_STREAMING ? &column_renderer->write_log : NULL);
+        }
+        set_highlights(&app);
 
-        SDL_Delay(DELAY_MS);
+        SDL_RenderClear(app.renderer);
+        draw_columns(app.renderer, &app.column_renderer, app.draw_info);
+        draw_overlay(&app);
+        frame_scheduler_present(scheduler);
+        SDL_RenderPresent(app.renderer);
+        frame_scheduler_end(scheduler);
     }
 
+    if (app.threaded) {
+        sort_worker_stop(&app.worker);
+    }
+    engine_free(&app.engine);
+    column_renderer_free(&app.column_renderer);
+    if (app.lod_enabled) {
+        column_lod_free(&app.lod);
+    }
+    if (app.replaying) {
+        trace_player_close(&app.player); // owns values
+    } else {
+        free(app.values);
+    }
     SDL_DestroyRenderer(app.renderer);
     SDL_DestroyWindow(app.window);
     SDL_Quit();
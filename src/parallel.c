@@ -0,0 +1,627 @@
+#include "parallel.h"
+#include "small_sort.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+static inline int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+int co_rank(int k, const int* a, int a_len, const int* b, int b_len, long long* comparisons) {
+    // binary search for the smallest i such that taking i elements from a
+    // and k - i from b does not leave an element of a that belongs before
+    // the last element taken from b
+    int lo = k > b_len ? k - b_len : 0;
+    int hi = k < a_len ? k : a_len;
+    while (lo < hi) {
+        int i = lo + (hi - lo) / 2;
+        int j = k - i;
+        if (comparisons != NULL && j > 0 && i < a_len) {
+            (*comparisons)++;
+        }
+        if (j > 0 && i < a_len && a[i] <= b[j - 1]) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// the merge of the level merging runs of width elements that contains
+// output index idx, [*left_idx, *mid) and [*mid, *right_idx)
+static void merge_window(int idx, int width, int len, int* left_idx, int* mid, int* right_idx) {
+    long long block = 2LL * width;
+    *left_idx = (int)(idx - idx % block);
+    *mid = (int)(*left_idx + (long long)width < len ? *left_idx + width : len);
+    *right_idx = (int)(*left_idx + block < len ? *left_idx + block : len);
+}
+
+// ================== One-shot ==================
+struct SortShared {
+    int* arr;
+    int* scratch;
+    int len;
+    int num_threads;
+    pthread_barrier_t barrier;
+    // the threads wait until the final number of threads is known before
+    // they use the barrier, see parallel_merge_sort
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    bool started;
+};
+
+struct SortThread {
+    struct SortShared* shared;
+    int id;
+    pthread_t thread;
+};
+
+// write dst[out_lo, out_hi) of the level merging runs of width elements
+// from src, a slice can span many merges or be a piece of a single one
+static void merge_slice(const int* src, int* dst, int len, int width, int out_lo, int out_hi) {
+    int pos = out_lo;
+    while (pos < out_hi) {
+        int left_idx, mid, right_idx;
+        merge_window(pos, width, len, &left_idx, &mid, &right_idx);
+        int end = min_int(out_hi, right_idx);
+
+        const int* a = src + left_idx;
+        const int* b = src + mid;
+        int a_len = mid - left_idx;
+        int b_len = right_idx - mid;
+        int i = co_rank(pos - left_idx, a, a_len, b, b_len, NULL);
+        int j = pos - left_idx - i;
+        int i_end = co_rank(end - left_idx, a, a_len, b, b_len, NULL);
+        int j_end = end - left_idx - i_end;
+
+        int* out = dst + pos;
+        while (i < i_end && j < j_end) {
+            *out++ = a[i] <= b[j] ? a[i++] : b[j++];
+        }
+        while (i < i_end) {
+            *out++ = a[i++];
+        }
+        while (j < j_end) {
+            *out++ = b[j++];
+        }
+        pos = end;
+    }
+}
+
+static void sort_levels(struct SortShared* shared, int id) {
+    int* arr = shared->arr;
+    int len = shared->len;
+    int n = shared->num_threads;
+
+    // sort short runs first, every level below PARALLEL_RUN_LEN would spend
+    // more time co-ranking than merging
+    int num_runs = (len + PARALLEL_RUN_LEN - 1) / PARALLEL_RUN_LEN;
+    int run_end = (int)((long long)num_runs * (id + 1) / n);
+    for (int r = (int)((long long)num_runs * id / n); r < run_end; r++) {
+        int run_idx = r * PARALLEL_RUN_LEN;
+        insertion_sort(arr + run_idx, min_int(PARALLEL_RUN_LEN, len - run_idx));
+    }
+
+    int out_lo = (int)((long long)len * id / n);
+    int out_hi = (int)((long long)len * (id + 1) / n);
+    int* src = arr;
+    int* dst = shared->scratch;
+    for (long long width = PARALLEL_RUN_LEN; width < len; width *= 2) {
+        // every slice of the previous level has to be written
+        pthread_barrier_wait(&shared->barrier);
+        merge_slice(src, dst, len, (int)width, out_lo, out_hi);
+        int* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    // the last level read from arr, so wait until every thread is done with
+    // it before each thread copies back the slice it wrote
+    if (src != arr) {
+        pthread_barrier_wait(&shared->barrier);
+        memcpy(arr + out_lo, src + out_lo, (out_hi - out_lo) * sizeof(int));
+    }
+}
+
+static void* sort_thread(void* arg) {
+    struct SortThread* thread = arg;
+    struct SortShared* shared = thread->shared;
+    pthread_mutex_lock(&shared->lock);
+    while (!shared->started) {
+        pthread_cond_wait(&shared->start, &shared->lock);
+    }
+    pthread_mutex_unlock(&shared->lock);
+
+    sort_levels(shared, thread->id);
+    return NULL;
+}
+
+bool parallel_merge_sort(int* arr, int len, int num_threads) {
+    if (len < 2) {
+        return true;
+    }
+    // a thread with less than one run to sort has nothing to do
+    int max_threads = (len + PARALLEL_RUN_LEN - 1) / PARALLEL_RUN_LEN;
+    num_threads = num_threads < 1 ? 1 : min_int(num_threads, max_threads);
+
+    struct SortShared shared = {
+        .arr = arr,
+        .scratch = malloc(len * sizeof(int)),
+        .len = len,
+        .started = false,
+    };
+    if (shared.scratch == NULL) {
+        return false;
+    }
+    struct SortThread* threads = malloc(num_threads * sizeof(struct SortThread));
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.start, NULL);
+
+    // the calling thread is thread 0, if a thread cannot be started the sort
+    // continues with the ones that could
+    int started = 1;
+    while (threads != NULL && started < num_threads) {
+        threads[started].shared = &shared;
+        threads[started].id = started;
+        if (pthread_create(&threads[started].thread, NULL, sort_thread, &threads[started]) != 0) {
+            break;
+        }
+        started++;
+    }
+
+    shared.num_threads = started;
+    pthread_barrier_init(&shared.barrier, NULL, started);
+    pthread_mutex_lock(&shared.lock);
+    shared.started = true;
+    pthread_cond_broadcast(&shared.start);
+    pthread_mutex_unlock(&shared.lock);
+
+    sort_levels(&shared, 0);
+    for (int t = 1; t < started; t++) {
+        pthread_join(threads[t].thread, NULL);
+    }
+
+    pthread_barrier_destroy(&shared.barrier);
+    pthread_cond_destroy(&shared.start);
+    pthread_mutex_destroy(&shared.lock);
+    free(threads);
+    free(shared.scratch);
+    return true;
+}
+
+// ================== Stepwise ==================
+// find the merge window that contains w->out_idx and the parts of both
+// runs that end up in the worker's slice of it
+static void worker_next_merge(struct ParallelMergeSortState* state, struct MergeWorker* w) {
+    int left_idx, mid, right_idx;
+    merge_window(w->out_idx, state->width, state->len, &left_idx, &mid, &right_idx);
+    int end = min_int(w->out_end, right_idx);
+
+    const int* a = state->scratch + left_idx;
+    const int* b = state->scratch + mid;
+    int a_len = mid - left_idx;
+    int b_len = right_idx - mid;
+    int k = w->out_idx - left_idx;
+    int k_end = end - left_idx;
+    int i = co_rank(k, a, a_len, b, b_len, &state->counters.comparisons);
+    int i_end = co_rank(k_end, a, a_len, b, b_len, &state->counters.comparisons);
+
+    w->merge_left_idx = left_idx;
+    w->merge_right_idx = right_idx - 1;
+    w->a_idx = left_idx + i;
+    w->a_end = left_idx + i_end;
+    w->b_idx = mid + k - i;
+    w->b_end = mid + k_end - i_end;
+}
+
+static void begin_level(struct ParallelMergeSortState* state) {
+    memcpy(state->scratch, state->arr, state->len * sizeof(int));
+    state->counters.writes += state->len;
+    for (int t = 0; t < PARALLEL_STEP_WORKERS; t++) {
+        struct MergeWorker* w = &state->workers[t];
+        w->out_idx = (int)((long long)state->len * t / PARALLEL_STEP_WORKERS);
+        w->out_end = (int)((long long)state->len * (t + 1) / PARALLEL_STEP_WORKERS);
+        if (w->out_idx < w->out_end) {
+            worker_next_merge(state, w);
+        }
+    }
+    state->level_done = false;
+}
+
+// write the next element of the worker's slice, returns false once the
+// whole slice is written
+static bool worker_step(struct ParallelMergeSortState* state, struct MergeWorker* w) {
+    if (w->out_idx >= w->out_end) {
+        return false;
+    }
+
+    const int* scratch = state->scratch;
+    bool both = w->a_idx < w->a_end && w->b_idx < w->b_end;
+    bool take_a = w->a_idx < w->a_end && (!both || scratch[w->a_idx] <= scratch[w->b_idx]);
+    state->arr[w->out_idx] = take_a ? scratch[w->a_idx++] : scratch[w->b_idx++];
+    state->counters.comparisons += both;
+    state->counters.writes++;
+    log_write(state->write_log, w->out_idx);
+    w->out_idx++;
+
+    if (w->a_idx == w->a_end && w->b_idx == w->b_end && w->out_idx < w->out_end) {
+        worker_next_merge(state, w);
+    }
+    return w->out_idx < w->out_end;
+}
+
+void parallel_merge_sort_init(struct ParallelMergeSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->counters = (struct Counters){0};
+    state->scratch = malloc(len * sizeof(int));
+    count_allocation(&state->counters, state->scratch, len * sizeof(int));
+    state->width = 1;
+    memset(state->workers, 0, sizeof(state->workers));
+    state->level_done = true;
+    // nothing can be merged without the scratch buffer
+    state->done = state->scratch == NULL;
+    state->write_log = NULL;
+}
+
+void parallel_merge_sort_step(struct ParallelMergeSortState* state) {
+    if (state->level_done) {
+        if (state->width >= state->len) {
+            state->done = true;
+        } else {
+            begin_level(state);
+        }
+        return;
+    }
+
+    bool active = false;
+    for (int t = 0; t < PARALLEL_STEP_WORKERS; t++) {
+        active |= worker_step(state, &state->workers[t]);
+    }
+    if (!active) {
+        state->width = state->width > state->len / 2 ? state->len : state->width * 2;
+        state->level_done = true;
+    }
+}
+
+long long parallel_merge_sort_step_n(struct ParallelMergeSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        parallel_merge_sort_step(state);
+    }
+    return i;
+}
+
+void parallel_merge_sort_free(struct ParallelMergeSortState* state) {
+    count_free(&state->counters, state->scratch, state->len * sizeof(int));
+    free(state->scratch);
+    state->scratch = NULL;
+}
+
+// ================== Range deque ==================
+static inline int range_len(struct QuickSortRange range) {
+    return range.right_idx - range.left_idx + 1;
+}
+
+static void deque_push(struct RangeDeque* deque, struct QuickSortRange range) {
+    deque->items[(deque->top + deque->count++) % RANGE_DEQUE_CAPACITY] = range;
+}
+
+static bool deque_pop(struct RangeDeque* deque, struct QuickSortRange* range) {
+    if (deque->count == 0) {
+        return false;
+    }
+    *range = deque->items[(deque->top + --deque->count) % RANGE_DEQUE_CAPACITY];
+    return true;
+}
+
+static bool deque_steal(struct RangeDeque* deque, struct QuickSortRange* range) {
+    if (deque->count == 0) {
+        return false;
+    }
+    *range = deque->items[deque->top];
+    deque->top = (deque->top + 1) % RANGE_DEQUE_CAPACITY;
+    deque->count--;
+    return true;
+}
+
+// elements of the range at the top of deque, 0 if it is empty
+static int deque_top_len(const struct RangeDeque* deque) {
+    return deque->count > 0 ? range_len(deque->items[deque->top]) : 0;
+}
+
+// ================== Work stealing ==================
+struct StealShared {
+    int* arr;
+    int num_workers;
+    struct StealWorker* workers;
+    // elements not yet in their final position, the sort is done at 0
+    atomic_int remaining;
+};
+
+struct StealWorker {
+    struct StealShared* shared;
+    int id;
+    pthread_t thread;
+    pthread_mutex_t lock; // guards deque
+    struct RangeDeque deque;
+};
+
+// three-way partition of [left_idx, right_idx] around the ninther pivot,
+// afterwards [*lt_idx, *gt_idx] holds the elements equal to it
+static void partition3(int* arr, int left_idx, int right_idx, int* lt_idx, int* gt_idx) {
+    int pivot = arr[quick_sort_pivot(arr, left_idx, right_idx, NULL)];
+    int lt = left_idx;
+    int i = left_idx;
+    int gt = right_idx;
+    while (i <= gt) {
+        int value = arr[i];
+        if (value < pivot) {
+            arr[i++] = arr[lt];
+            arr[lt++] = value;
+        } else if (value > pivot) {
+            arr[i] = arr[gt];
+            arr[gt--] = value;
+        } else {
+            i++;
+        }
+    }
+    *lt_idx = lt;
+    *gt_idx = gt;
+}
+
+static void sequential_quick_sort(int* arr, int left_idx, int right_idx) {
+    // recurse into the smaller side only, as quick_sort_recursive does
+    while (right_idx - left_idx + 1 > QUICK_SORT_CUTOFF) {
+        int lt, gt;
+        partition3(arr, left_idx, right_idx, &lt, &gt);
+        if (lt - left_idx < right_idx - gt) {
+            sequential_quick_sort(arr, left_idx, lt - 1);
+            left_idx = gt + 1;
+        } else {
+            sequential_quick_sort(arr, gt + 1, right_idx);
+            right_idx = lt - 1;
+        }
+    }
+    if (left_idx < right_idx) {
+        insertion_sort(arr + left_idx, right_idx - left_idx + 1);
+    }
+}
+
+static void push_range(struct StealWorker* worker, struct QuickSortRange range) {
+    pthread_mutex_lock(&worker->lock);
+    deque_push(&worker->deque, range);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+static bool pop_range(struct StealWorker* worker, struct QuickSortRange* range) {
+    pthread_mutex_lock(&worker->lock);
+    bool found = deque_pop(&worker->deque, range);
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+// take the largest range at the top of any other worker's deque
+static bool steal_range(struct StealShared* shared, int id, struct QuickSortRange* range) {
+    int victim = -1;
+    int victim_len = 0;
+    for (int w = 0; w < shared->num_workers; w++) {
+        if (w == id) {
+            continue;
+        }
+        pthread_mutex_lock(&shared->workers[w].lock);
+        int len = deque_top_len(&shared->workers[w].deque);
+        pthread_mutex_unlock(&shared->workers[w].lock);
+        if (len > victim_len) {
+            victim = w;
+            victim_len = len;
+        }
+    }
+    if (victim < 0) {
+        return false;
+    }
+    // the top may have been taken in the meantime, whatever is there now is
+    // still one of the largest ranges of that deque
+    pthread_mutex_lock(&shared->workers[victim].lock);
+    bool found = deque_steal(&shared->workers[victim].deque, range);
+    pthread_mutex_unlock(&shared->workers[victim].lock);
+    return found;
+}
+
+static void sort_range(struct StealWorker* worker, struct QuickSortRange range) {
+    struct StealShared* shared = worker->shared;
+    while (range_len(range) > PARALLEL_QUICK_SORT_CUTOFF) {
+        int lt, gt;
+        partition3(shared->arr, range.left_idx, range.right_idx, &lt, &gt);
+        // the copies of the pivot are in place
+        atomic_fetch_sub(&shared->remaining, gt - lt + 1);
+
+        struct QuickSortRange left = {range.left_idx, lt - 1};
+        struct QuickSortRange right = {gt + 1, range.right_idx};
+        struct QuickSortRange larger = range_len(left) > range_len(right) ? left : right;
+        range = range_len(left) > range_len(right) ? right : left;
+        // offer the larger side to idle workers, continue with the smaller
+        if (range_len(larger) > 1) {
+            push_range(worker, larger);
+        } else {
+            atomic_fetch_sub(&shared->remaining, range_len(larger));
+        }
+    }
+    if (range_len(range) > 0) {
+        sequential_quick_sort(shared->arr, range.left_idx, range.right_idx);
+        atomic_fetch_sub(&shared->remaining, range_len(range));
+    }
+}
+
+static void* steal_thread(void* arg) {
+    struct StealWorker* worker = arg;
+    struct StealShared* shared = worker->shared;
+    while (atomic_load(&shared->remaining) > 0) {
+        struct QuickSortRange range;
+        if (pop_range(worker, &range) || steal_range(shared, worker->id, &range)) {
+            sort_range(worker, range);
+        } else {
+            // nothing to do until another worker pushes a range
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void parallel_quick_sort(int* arr, int len, int num_threads) {
+    if (len < 2) {
+        return;
+    }
+    num_threads = num_threads < 1 ? 1 : num_threads;
+    struct StealWorker* workers = malloc(num_threads * sizeof(struct StealWorker));
+    if (workers == NULL) {
+        sequential_quick_sort(arr, 0, len - 1);
+        return;
+    }
+
+    struct StealShared shared = {
+        .arr = arr,
+        .num_workers = num_threads,
+        .workers = workers,
+    };
+    atomic_init(&shared.remaining, len);
+    for (int w = 0; w < num_threads; w++) {
+        workers[w].shared = &shared;
+        workers[w].id = w;
+        workers[w].deque.top = 0;
+        workers[w].deque.count = 0;
+        pthread_mutex_init(&workers[w].lock, NULL);
+    }
+    deque_push(&workers[0].deque, (struct QuickSortRange){0, len - 1});
+
+    // the calling thread is worker 0, workers that cannot be started keep an
+    // empty deque that nobody pushes to
+    int started = 1;
+    while (started < num_threads &&
+           pthread_create(&workers[started].thread, NULL, steal_thread, &workers[started]) == 0) {
+        started++;
+    }
+    steal_thread(&workers[0]);
+    for (int w = 1; w < started; w++) {
+        pthread_join(workers[w].thread, NULL);
+    }
+
+    for (int w = 0; w < num_threads; w++) {
+        pthread_mutex_destroy(&workers[w].lock);
+    }
+    free(workers);
+}
+
+// ================== Work stealing stepwise ==================
+static bool take_range(struct ParallelQuickSortState* state, int id, struct QuickSortRange* range) {
+    if (deque_pop(&state->workers[id].deque, range)) {
+        return true;
+    }
+    int victim = -1;
+    int victim_len = 0;
+    for (int w = 0; w < PARALLEL_STEP_WORKERS; w++) {
+        int len = deque_top_len(&state->workers[w].deque);
+        if (w != id && len > victim_len) {
+            victim = w;
+            victim_len = len;
+        }
+    }
+    if (victim < 0) {
+        return false;
+    }
+    state->steals++;
+    return deque_steal(&state->workers[victim].deque, range);
+}
+
+static void quick_worker_start(struct ParallelQuickSortState* state, struct QuickWorker* w, struct QuickSortRange range) {
+    w->busy = true;
+    w->left_idx = range.left_idx;
+    w->right_idx = range.right_idx;
+    w->pivot = state->arr[quick_sort_pivot(state->arr, range.left_idx, range.right_idx,
+                                           &state->counters.comparisons)];
+    w->lt_idx = range.left_idx;
+    w->iter_idx = range.left_idx;
+    w->gt_idx = range.right_idx;
+}
+
+static inline void swap_logged(struct ParallelQuickSortState* state, int a, int b) {
+    int temp = state->arr[a];
+    state->arr[a] = state->arr[b];
+    state->arr[b] = temp;
+    state->counters.swaps++;
+    state->counters.writes += 2;
+    log_write(state->write_log, a);
+    log_write(state->write_log, b);
+}
+
+static void quick_worker_step(struct ParallelQuickSortState* state, struct QuickWorker* w) {
+    if (w->iter_idx <= w->gt_idx) {
+        // one comparison, or two unless the element is less than the pivot
+        int value = state->arr[w->iter_idx];
+        state->counters.comparisons += value < w->pivot ? 1 : 2;
+        if (value < w->pivot) {
+            swap_logged(state, w->lt_idx++, w->iter_idx++);
+        } else if (value > w->pivot) {
+            swap_logged(state, w->iter_idx, w->gt_idx--);
+        } else {
+            w->iter_idx++;
+        }
+        return;
+    }
+
+    // larger side first so that the worker continues with the smaller one,
+    // ranges with less than two elements are already sorted
+    struct QuickSortRange left = {w->left_idx, w->lt_idx - 1};
+    struct QuickSortRange right = {w->gt_idx + 1, w->right_idx};
+    bool left_larger = range_len(left) > range_len(right);
+    struct QuickSortRange larger = left_larger ? left : right;
+    struct QuickSortRange smaller = left_larger ? right : left;
+    if (range_len(larger) > 1) {
+        deque_push(&w->deque, larger);
+    }
+    if (range_len(smaller) > 1) {
+        deque_push(&w->deque, smaller);
+    }
+    w->busy = false;
+}
+
+void parallel_quick_sort_init(struct ParallelQuickSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    memset(state->workers, 0, sizeof(state->workers));
+    state->steals = 0;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+    if (len > 1) {
+        deque_push(&state->workers[0].deque, (struct QuickSortRange){0, len - 1});
+    }
+}
+
+void parallel_quick_sort_step(struct ParallelQuickSortState* state) {
+    bool active = false;
+    for (int id = 0; id < PARALLEL_STEP_WORKERS; id++) {
+        struct QuickWorker* w = &state->workers[id];
+        struct QuickSortRange range;
+        if (w->busy) {
+            quick_worker_step(state, w);
+            active = true;
+        } else if (take_range(state, id, &range)) {
+            quick_worker_start(state, w, range);
+            active = true;
+        }
+    }
+    // every worker is idle and every deque empty
+    state->done = !active;
+}
+
+long long parallel_quick_sort_step_n(struct ParallelQuickSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        parallel_quick_sort_step(state);
+    }
+    return i;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+
+// Bottom-up merge sort that splits every level across threads. The output
+// of a level is cut into one equal slice per thread and each thread merges
+// exactly the elements that end up in its slice, finding where its slice
+// starts in both input runs by co-ranking. Early levels have many small
+// merges per slice, the last levels have slices that are pieces of a
+// single merge, so every thread does len / num_threads work per level.
+
+// elements each thread sorts with insertion sort before the first level
+#define PARALLEL_RUN_LEN 32
+// virtual workers of the stepwise mode, each gets its own highlight color
+#define PARALLEL_STEP_WORKERS 4
+
+// number of elements taken from a among the first k elements of the stable
+// merge of a and b, ties are taken from a first, adds the comparisons it
+// makes to comparisons unless that is NULL
+int co_rank(int k, const int* a, int a_len, const int* b, int b_len, long long* comparisons);
+
+// sorts arr with num_threads threads (including the calling one), returns
+// false if the scratch buffer could not be allocated, fewer threads are
+// used if some of them could not be started
+bool parallel_merge_sort(int* arr, int len, int num_threads);
+
+// the slice [out_idx, out_end) of the current level a worker writes, one
+// merge window [merge_left_idx, merge_right_idx] at a time
+struct MergeWorker {
+    int out_idx;
+    int out_end;
+    int merge_left_idx;
+    int merge_right_idx;
+    int a_idx; // next element of the left run in scratch
+    int a_end;
+    int b_idx; // next element of the right run in scratch
+    int b_end;
+};
+
+// Stepwise version that interleaves PARALLEL_STEP_WORKERS virtual workers on
+// the calling thread, every step writes one element per worker. Each level
+// starts by copying arr to scratch, the workers then merge from scratch
+// back into arr.
+struct ParallelMergeSortState {
+    int* arr;
+    int len;
+    int* scratch; // len ints
+    int width;    // length of the sorted runs merged by the current level
+    struct MergeWorker workers[PARALLEL_STEP_WORKERS];
+    bool level_done;
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void parallel_merge_sort_init(struct ParallelMergeSortState* state, int* arr, int len);
+void parallel_merge_sort_step(struct ParallelMergeSortState* state);
+long long parallel_merge_sort_step_n(struct ParallelMergeSortState* state, long long n);
+void parallel_merge_sort_free(struct ParallelMergeSortState* state);
+
+// Quick sort where every worker owns a deque of ranges that still have to
+// be partitioned. A worker keeps partitioning the smaller side of its last
+// partition and pushes the larger side to the bottom of its deque, an idle
+// worker steals the largest range from the top of any other deque.
+
+// ranges with at most this many elements are sorted sequentially by the
+// worker that holds them instead of being split further
+#define PARALLEL_QUICK_SORT_CUTOFF (1 << 13)
+// each worker always continues with the smaller side, so its deque holds at
+// most log2(len) + 1 ranges
+#define RANGE_DEQUE_CAPACITY 64
+
+// ring buffer of ranges, the owner pushes and pops at the bottom (the
+// newest and smallest ranges) and thieves take from the top (the oldest and
+// largest)
+struct RangeDeque {
+    struct QuickSortRange items[RANGE_DEQUE_CAPACITY];
+    int top;
+    int count;
+};
+
+// sorts arr with num_threads threads (including the calling one), fewer
+// threads are used if some of them could not be started
+void parallel_quick_sort(int* arr, int len, int num_threads);
+
+// a virtual worker of the stepwise mode, it is busy while it partitions
+// [left_idx, right_idx] three-way as in QuickSortState
+struct QuickWorker {
+    struct RangeDeque deque;
+    bool busy;
+    int left_idx;
+    int right_idx;
+    int pivot;
+    int lt_idx;
+    int iter_idx;
+    int gt_idx;
+};
+
+// Stepwise version with PARALLEL_STEP_WORKERS virtual workers interleaved
+// on the calling thread, every step each worker either makes one partition
+// comparison or takes its next range, stealing it if its own deque is empty
+struct ParallelQuickSortState {
+    int* arr;
+    int len;
+    struct QuickWorker workers[PARALLEL_STEP_WORKERS];
+    long long steals; // ranges taken from another worker's deque
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void parallel_quick_sort_init(struct ParallelQuickSortState* state, int* arr, int len);
+void parallel_quick_sort_step(struct ParallelQuickSortState* state);
+long long parallel_quick_sort_step_n(struct ParallelQuickSortState* state, long long n);
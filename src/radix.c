@@ -0,0 +1,401 @@
+#include "radix.h"
+#include "small_sort.h"
+#include <string.h>
+
+#define RADIX_FAST_BUCKETS (1 << RADIX_FAST_BITS)
+// 32 bit keys split into RADIX_FAST_BITS bit digits
+#define RADIX_FAST_PASSES ((32 + RADIX_FAST_BITS - 1) / RADIX_FAST_BITS)
+
+static inline unsigned int radix_key(int value) {
+    return (unsigned int)value ^ 0x80000000u;
+}
+
+static inline int radix_digit(int value, int shift) {
+    return (radix_key(value) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// shift of the most significant bits wide digit in which the values of arr
+// differ, -1 if they are all the same
+static int top_shift(const int* arr, int len, int bits) {
+    if (len < 2) {
+        return -1;
+    }
+    unsigned int diff = 0;
+    unsigned int first = radix_key(arr[0]);
+    for (int i = 1; i < len; i++) {
+        diff |= radix_key(arr[i]) ^ first;
+    }
+    if (diff == 0) {
+        return -1;
+    }
+    int top_bit = 31 - __builtin_clz(diff);
+    return top_bit / bits * bits;
+}
+
+// ================== One-shot ==================
+bool radix_lsd_sort(int* arr, int len) {
+    int max_shift = top_shift(arr, len, RADIX_FAST_BITS);
+    if (max_shift < 0) {
+        return true;
+    }
+    int* scratch = malloc(len * sizeof(int));
+    if (scratch == NULL) {
+        return false;
+    }
+
+    // the histograms of all passes are built in a single read of arr, every
+    // pass after that is one sequential read and one write stream per bucket
+    int num_passes = max_shift / RADIX_FAST_BITS + 1;
+    int counts[RADIX_FAST_PASSES][RADIX_FAST_BUCKETS] = {{0}};
+    for (int i = 0; i < len; i++) {
+        unsigned int key = radix_key(arr[i]);
+        for (int p = 0; p < num_passes; p++) {
+            counts[p][(key >> (p * RADIX_FAST_BITS)) & (RADIX_FAST_BUCKETS - 1)]++;
+        }
+    }
+
+    int* src = arr;
+    int* dst = scratch;
+    for (int p = 0; p < num_passes; p++) {
+        int shift = p * RADIX_FAST_BITS;
+        int* offsets = counts[p];
+        // a digit shared by every element would not move anything
+        if (offsets[(radix_key(src[0]) >> shift) & (RADIX_FAST_BUCKETS - 1)] == len) {
+            continue;
+        }
+        int sum = 0;
+        for (int b = 0; b < RADIX_FAST_BUCKETS; b++) {
+            int count = offsets[b];
+            offsets[b] = sum;
+            sum += count;
+        }
+        for (int i = 0; i < len; i++) {
+            int value = src[i];
+            dst[offsets[(radix_key(value) >> shift) & (RADIX_FAST_BUCKETS - 1)]++] = value;
+        }
+        int* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    if (src != arr) {
+        memcpy(arr, src, len * sizeof(int));
+    }
+    free(scratch);
+    return true;
+}
+
+static void msd_sort(int* arr, int len, int shift) {
+    if (len <= RADIX_MSD_CUTOFF) {
+        insertion_sort(arr, len);
+        return;
+    }
+
+    int counts[RADIX_BUCKETS];
+    while (true) {
+        memset(counts, 0, sizeof(counts));
+        for (int i = 0; i < len; i++) {
+            counts[radix_digit(arr[i], shift)]++;
+        }
+        if (counts[radix_digit(arr[0], shift)] < len) {
+            break;
+        }
+        // every element has this digit, split by the next one instead
+        if (shift == 0) {
+            return;
+        }
+        shift -= RADIX_BITS;
+    }
+
+    int heads[RADIX_BUCKETS];
+    int ends[RADIX_BUCKETS];
+    int sum = 0;
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        heads[b] = sum;
+        sum += counts[b];
+        ends[b] = sum;
+    }
+
+    // carry each misplaced element to the next free slot of its bucket and
+    // continue with the element that was there until one belongs here
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        while (heads[b] < ends[b]) {
+            int value = arr[heads[b]];
+            int d = radix_digit(value, shift);
+            while (d != b) {
+                int temp = arr[heads[d]];
+                arr[heads[d]++] = value;
+                value = temp;
+                d = radix_digit(value, shift);
+            }
+            arr[heads[b]++] = value;
+        }
+    }
+
+    if (shift == 0) {
+        return;
+    }
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        int start = b == 0 ? 0 : ends[b - 1];
+        msd_sort(arr + start, ends[b] - start, shift - RADIX_BITS);
+    }
+}
+
+void radix_msd_sort(int* arr, int len) {
+    int shift = top_shift(arr, len, RADIX_BITS);
+    if (shift >= 0) {
+        msd_sort(arr, len, shift);
+    }
+}
+
+// ================== LSD ==================
+static void lsd_begin_pass(struct RadixLsdState* state) {
+    memset(state->counts, 0, sizeof(state->counts));
+    state->phase = RADIX_LSD_COUNT;
+    state->iter_idx = 0;
+    state->active_bucket = -1;
+    state->write_idx = -1;
+}
+
+static void lsd_next_pass(struct RadixLsdState* state) {
+    state->shift += RADIX_BITS;
+    if (state->shift > state->max_shift) {
+        state->done = true;
+        state->active_bucket = -1;
+        state->write_idx = -1;
+        return;
+    }
+    lsd_begin_pass(state);
+}
+
+void radix_lsd_sort_init(struct RadixLsdState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->counters = (struct Counters){0};
+    state->scratch = malloc(len * sizeof(int));
+    count_allocation(&state->counters, state->scratch, len * sizeof(int));
+    state->shift = 0;
+    state->max_shift = top_shift(arr, len, RADIX_BITS);
+    state->write_log = NULL;
+    lsd_begin_pass(state);
+    // nothing can be scattered without the scratch buffer
+    state->done = state->max_shift < 0 || state->scratch == NULL;
+}
+
+void radix_lsd_sort_free(struct RadixLsdState* state) {
+    count_free(&state->counters, state->scratch, state->len * sizeof(int));
+    free(state->scratch);
+    state->scratch = NULL;
+}
+
+void radix_lsd_sort_step(struct RadixLsdState* state) {
+    switch (state->phase) {
+    case RADIX_LSD_COUNT:
+        if (state->iter_idx < state->len) {
+            int value = state->arr[state->iter_idx];
+            int d = radix_digit(value, state->shift);
+            state->scratch[state->iter_idx++] = value;
+            state->counters.writes++;
+            state->counts[d]++;
+            state->active_bucket = d;
+            return;
+        }
+        // a digit shared by every element would not move anything
+        if (state->counts[radix_digit(state->scratch[0], state->shift)] == state->len) {
+            lsd_next_pass(state);
+            return;
+        }
+        state->phase = RADIX_LSD_PREFIX;
+        state->iter_idx = 0;
+        return;
+    case RADIX_LSD_PREFIX: {
+        int b = state->iter_idx++;
+        state->offsets[b] = b == 0 ? 0 : state->offsets[b - 1] + state->counts[b - 1];
+        state->active_bucket = b;
+        if (state->iter_idx == RADIX_BUCKETS) {
+            state->phase = RADIX_LSD_SCATTER;
+            state->iter_idx = 0;
+        }
+        return;
+    }
+    case RADIX_LSD_SCATTER:
+        if (state->iter_idx < state->len) {
+            int value = state->scratch[state->iter_idx++];
+            int d = radix_digit(value, state->shift);
+            state->write_idx = state->offsets[d]++;
+            state->arr[state->write_idx] = value;
+            state->counters.writes++;
+            log_write(state->write_log, state->write_idx);
+            state->counts[d]--;
+            state->active_bucket = d;
+            return;
+        }
+        lsd_next_pass(state);
+        return;
+    }
+}
+
+long long radix_lsd_sort_step_n(struct RadixLsdState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        radix_lsd_sort_step(state);
+    }
+    return i;
+}
+
+// ================== MSD ==================
+static void msd_push_range(struct RadixMsdState* state, int left_idx, int right_idx, int shift) {
+    // ranges with less than two elements are already sorted
+    if (left_idx < right_idx) {
+        state->stack[state->stack_ptr++] = (struct RadixMsdRange){left_idx, right_idx, shift};
+    }
+}
+
+static void msd_begin_count(struct RadixMsdState* state) {
+    memset(state->counts, 0, sizeof(state->counts));
+    state->phase = RADIX_MSD_COUNT;
+    state->iter_idx = state->left_idx;
+    state->swap_idx = -1;
+}
+
+static void msd_next_range(struct RadixMsdState* state) {
+    if (state->stack_ptr == 0) {
+        state->done = true;
+        return;
+    }
+    struct RadixMsdRange range = state->stack[--state->stack_ptr];
+    state->left_idx = range.left_idx;
+    state->right_idx = range.right_idx;
+    state->shift = range.shift;
+    if (range.right_idx - range.left_idx + 1 <= RADIX_MSD_CUTOFF) {
+        state->phase = RADIX_MSD_INSERTION;
+        state->iter_idx = range.left_idx + 1;
+        state->insert_idx = range.left_idx;
+        state->value = state->arr[state->iter_idx];
+    } else {
+        msd_begin_count(state);
+    }
+}
+
+// every bucket of the finished range is split by the next digit, pushed in
+// reverse so that the leftmost bucket is sorted first
+static void msd_push_buckets(struct RadixMsdState* state) {
+    if (state->shift == 0) {
+        return;
+    }
+    for (int b = RADIX_BUCKETS - 1; b >= 0; b--) {
+        int start = b == 0 ? state->left_idx : state->ends[b - 1];
+        msd_push_range(state, start, state->ends[b] - 1, state->shift - RADIX_BITS);
+    }
+}
+
+void radix_msd_sort_init(struct RadixMsdState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->stack_ptr = 0;
+    state->phase = RADIX_MSD_NEXT_RANGE;
+    state->left_idx = 0;
+    state->right_idx = len - 1;
+    state->shift = top_shift(arr, len, RADIX_BITS);
+    state->iter_idx = 0;
+    memset(state->counts, 0, sizeof(state->counts));
+    state->swap_idx = -1;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+    if (state->shift >= 0) {
+        msd_push_range(state, 0, len - 1, state->shift);
+    }
+    state->done = state->stack_ptr == 0;
+}
+
+void radix_msd_sort_step(struct RadixMsdState* state) {
+    int* arr = state->arr;
+    switch (state->phase) {
+    case RADIX_MSD_NEXT_RANGE:
+        msd_next_range(state);
+        return;
+    case RADIX_MSD_COUNT: {
+        if (state->iter_idx <= state->right_idx) {
+            state->counts[radix_digit(arr[state->iter_idx++], state->shift)]++;
+            return;
+        }
+        int len = state->right_idx - state->left_idx + 1;
+        if (state->counts[radix_digit(arr[state->left_idx], state->shift)] < len) {
+            state->phase = RADIX_MSD_PREFIX;
+            state->iter_idx = 0;
+        } else if (state->shift > 0) {
+            // every element has this digit, split by the next one instead
+            state->shift -= RADIX_BITS;
+            msd_begin_count(state);
+        } else {
+            state->phase = RADIX_MSD_NEXT_RANGE;
+        }
+        return;
+    }
+    case RADIX_MSD_PREFIX: {
+        int b = state->iter_idx++;
+        state->heads[b] = b == 0 ? state->left_idx : state->ends[b - 1];
+        state->ends[b] = state->heads[b] + state->counts[b];
+        if (state->iter_idx == RADIX_BUCKETS) {
+            state->phase = RADIX_MSD_PERMUTE;
+            state->iter_idx = 0;
+        }
+        return;
+    }
+    case RADIX_MSD_PERMUTE: {
+        int b = state->iter_idx;
+        if (b == RADIX_BUCKETS) {
+            msd_push_buckets(state);
+            state->phase = RADIX_MSD_NEXT_RANGE;
+            return;
+        }
+        if (state->heads[b] >= state->ends[b]) {
+            state->iter_idx++;
+            return;
+        }
+        // either the element at the head of bucket b belongs there, or it
+        // is swapped into the next free slot of its own bucket
+        int idx = state->heads[b];
+        int value = arr[idx];
+        int d = radix_digit(value, state->shift);
+        int slot = state->heads[d]++;
+        if (d != b) {
+            arr[idx] = arr[slot];
+            arr[slot] = value;
+            state->counters.swaps++;
+            state->counters.writes += 2;
+            log_write(state->write_log, idx);
+            log_write(state->write_log, slot);
+        }
+        state->counts[d]--;
+        state->swap_idx = slot;
+        return;
+    }
+    case RADIX_MSD_INSERTION:
+        state->counters.comparisons += state->insert_idx >= state->left_idx;
+        state->counters.writes++;
+        if (state->insert_idx >= state->left_idx && arr[state->insert_idx] > state->value) {
+            arr[state->insert_idx + 1] = arr[state->insert_idx];
+            log_write(state->write_log, state->insert_idx + 1);
+            state->insert_idx--;
+            return;
+        }
+        arr[state->insert_idx + 1] = state->value;
+        log_write(state->write_log, state->insert_idx + 1);
+        if (++state->iter_idx > state->right_idx) {
+            state->phase = RADIX_MSD_NEXT_RANGE;
+            return;
+        }
+        state->insert_idx = state->iter_idx - 1;
+        state->value = arr[state->iter_idx];
+        return;
+    }
+}
+
+long long radix_msd_sort_step_n(struct RadixMsdState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        radix_msd_sort_step(state);
+    }
+    return i;
+}
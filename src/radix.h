@@ -0,0 +1,107 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+
+// Radix sorts, they look at the digits of the values instead of comparing
+// them. Values are turned into keys by flipping the sign bit, which orders
+// negative values before positive ones when the keys are compared unsigned.
+// Only the digits up to the most significant bit in which the values differ
+// are sorted, so bounded values take a single pass or two.
+
+// digits of the stepwise sorts, one histogram bucket per digit value
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+// digits of the one-shot LSD sort, its 2048 counters per pass fit in L1
+// and three passes cover 32 bit keys
+#define RADIX_FAST_BITS 11
+// MSD ranges with at most this many elements are finished with insertion sort
+#define RADIX_MSD_CUTOFF 32
+// a range pushes at most RADIX_BUCKETS subranges one digit further down,
+// and there are 32 / RADIX_BITS digits
+#define RADIX_MSD_MAX_RANGES (RADIX_BUCKETS * 32 / RADIX_BITS)
+
+// one-shot sorts, radix_lsd_sort returns false if its scratch buffer could
+// not be allocated, radix_msd_sort is in place
+bool radix_lsd_sort(int* arr, int len);
+void radix_msd_sort(int* arr, int len);
+
+enum RadixLsdPhase {
+    RADIX_LSD_COUNT,   // build the histogram of the current digit
+    RADIX_LSD_PREFIX,  // turn the histogram into bucket offsets
+    RADIX_LSD_SCATTER, // move every element to the next slot of its bucket
+};
+
+// Stepwise LSD sort, one pass per digit from the least significant one. The
+// counting pass also copies arr to scratch, the scatter pass then moves the
+// elements from scratch back into arr, so every write of the sort lands in
+// arr. A pass whose digit is the same for every element is skipped.
+struct RadixLsdState {
+    int* arr;
+    int len;
+    int* scratch; // len ints
+    int shift;    // of the current digit
+    int max_shift;
+    enum RadixLsdPhase phase;
+    int iter_idx; // element while counting and scattering, bucket otherwise
+    // elements per digit, it fills up while counting and drains while
+    // scattering
+    int counts[RADIX_BUCKETS];
+    int offsets[RADIX_BUCKETS]; // next slot of each bucket
+    int active_bucket;          // bucket of the last element, -1 if none
+    int write_idx;              // last slot written, -1 if none
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void radix_lsd_sort_init(struct RadixLsdState* state, int* arr, int len);
+void radix_lsd_sort_step(struct RadixLsdState* state);
+long long radix_lsd_sort_step_n(struct RadixLsdState* state, long long n);
+void radix_lsd_sort_free(struct RadixLsdState* state);
+
+enum RadixMsdPhase {
+    RADIX_MSD_NEXT_RANGE,
+    RADIX_MSD_COUNT,
+    RADIX_MSD_PREFIX,
+    RADIX_MSD_PERMUTE,
+    RADIX_MSD_INSERTION,
+};
+
+struct RadixMsdRange {
+    int left_idx;
+    int right_idx;
+    int shift; // of the digit the range is split by
+};
+
+// Stepwise in-place MSD sort (American flag sort). A range is counted, the
+// bucket boundaries are computed from the counts, and then every step swaps
+// one element into the next free slot of its bucket. Each bucket becomes a
+// range of its own for the next digit.
+struct RadixMsdState {
+    int* arr;
+    int len;
+    struct RadixMsdRange stack[RADIX_MSD_MAX_RANGES];
+    int stack_ptr;
+    enum RadixMsdPhase phase;
+    int left_idx;
+    int right_idx;
+    int shift;
+    // element while counting and sorting the range with insertion sort,
+    // bucket while computing the boundaries and permuting
+    int iter_idx;
+    // elements per digit that are not in their bucket yet
+    int counts[RADIX_BUCKETS];
+    int heads[RADIX_BUCKETS]; // next unplaced slot of each bucket
+    int ends[RADIX_BUCKETS];  // one past the last slot of each bucket
+    int swap_idx;             // last slot an element was swapped into, -1 if none
+    int insert_idx;           // inner loop of the insertion sort
+    int value;
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void radix_msd_sort_init(struct RadixMsdState* state, int* arr, int len);
+void radix_msd_sort_step(struct RadixMsdState* state);
+long long radix_msd_sort_step_n(struct RadixMsdState* state, long long n);
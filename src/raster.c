@@ -0,0 +1,200 @@
+#include "raster.h"
+#include "font.h"
+#include <stdlib.h>
+
+const Color_t PRIMARY = {4, 191, 157, 255};
+const Color_t SECONDARY = {210, 64, 31, 255};
+const Color_t TERTIARY = {200, 180, 60, 255};
+const Color_t LIGHT = {220, 220, 220, 255};
+const Color_t DARK = {6, 10, 18, 255};
+const Color_t MUTED = {110, 110, 110, 255};
+const Color_t WORKER_COLORS[NUM_WORKER_COLORS] = {
+    {4, 191, 157, 255},
+    {210, 64, 31, 255},
+    {200, 180, 60, 255},
+    {90, 120, 230, 255},
+};
+
+// ================== Highlights ==================
+Color_t highlight_color(struct Highlight highlight) {
+    switch (highlight.role) {
+    case HIGHLIGHT_SECONDARY:
+        return SECONDARY;
+    case HIGHLIGHT_TERTIARY:
+        return TERTIARY;
+    case HIGHLIGHT_WORKER:
+        return WORKER_COLORS[highlight.worker % NUM_WORKER_COLORS];
+    default:
+        return PRIMARY;
+    }
+}
+
+void mark_highlights(int* map, const struct ColumnDrawData* data, int num_columns) {
+    for (int j = 0; j < data->num_colored_columns; j++) {
+        int idx = data->colored_columns_indices[j];
+        if (idx >= 0 && idx < num_columns && map[idx] < 0) {
+            map[idx] = j;
+        }
+    }
+}
+
+void clear_highlights(int* map, const struct ColumnDrawData* data, int num_columns) {
+    for (int j = 0; j < data->num_colored_columns; j++) {
+        int idx = data->colored_columns_indices[j];
+        if (idx >= 0 && idx < num_columns) {
+            map[idx] = -1;
+        }
+    }
+}
+
+Color_t column_color(const int* map, const struct ColumnDrawData* data, int i) {
+    return map[i] < 0 ? LIGHT : data->colors[map[i]];
+}
+
+// ================== Raster ==================
+static int clamp(int v, int min, int max) {
+    return v < min ? min : (v > max ? max : v);
+}
+
+bool raster_init(struct Raster* raster, int width, int height) {
+    raster->pixels = malloc((size_t)width * height * sizeof(uint32_t));
+    raster->width = raster->pixels != NULL ? width : 0;
+    raster->height = raster->pixels != NULL ? height : 0;
+    return raster->pixels != NULL;
+}
+
+void raster_free(struct Raster* raster) {
+    free(raster->pixels);
+    raster->pixels = NULL;
+    raster->width = 0;
+    raster->height = 0;
+}
+
+uint32_t color_to_argb(Color_t color) {
+    return (uint32_t)color.a << 24 | (uint32_t)color.r << 16 | (uint32_t)color.g << 8 | color.b;
+}
+
+void raster_column_span(const struct Raster* raster, const struct ColumnDrawData* data, int i, int* x, int* w) {
+    int x0 = data->x + i * data->w;
+    int x1 = x0 + data->w;
+    x0 = x0 < 0 ? 0 : x0;
+    x1 = x1 > raster->width ? raster->width : x1;
+    *x = x0;
+    *w = x1 > x0 ? x1 - x0 : 0;
+}
+
+void raster_column(struct Raster* raster, const struct ColumnDrawData* data, const int* highlight_map, int i) {
+    int x, w;
+    raster_column_span(raster, data, i, &x, &w);
+    if (w == 0) {
+        return;
+    }
+
+    // the bar covers rows [top, bottom), for envelope columns the band
+    // covers [band_top, top) and the mean is drawn on row mean_row
+    int bottom = data->y < raster->height ? data->y : raster->height;
+    int band_top = clamp(data->y - data->columns[i], 0, bottom);
+    int top = band_top;
+    int mean_row = -1;
+    if (data->column_min != NULL && highlight_map[i] < 0) {
+        top = clamp(data->y - data->column_min[i], 0, bottom);
+        if (top > band_top) {
+            mean_row = clamp(data->y - data->column_mean[i] - 1, band_top, top - 1);
+        }
+    }
+
+    uint32_t background = color_to_argb(DARK);
+    uint32_t band = color_to_argb(MUTED);
+    uint32_t bar = color_to_argb(column_color(highlight_map, data, i));
+    for (int row = 0; row < raster->height; row++) {
+        uint32_t pixel = background;
+        if (row == mean_row) {
+            pixel = bar;
+        } else if (row >= top && row < bottom) {
+            pixel = bar;
+        } else if (row >= band_top && row < top) {
+            pixel = band;
+        }
+
+        uint32_t* line = raster->pixels + (size_t)row * raster->width + x;
+        for (int col = 0; col < w; col++) {
+            line[col] = pixel;
+        }
+    }
+}
+
+void raster_columns(struct Raster* raster, const struct ColumnDrawData* data, int* highlight_map) {
+    uint32_t background = color_to_argb(DARK);
+    size_t num_pixels = (size_t)raster->width * raster->height;
+    for (size_t p = 0; p < num_pixels; p++) {
+        raster->pixels[p] = background;
+    }
+
+    mark_highlights(highlight_map, data, data->num_columns);
+    for (int i = 0; i < data->num_columns; i++) {
+        raster_column(raster, data, highlight_map, i);
+    }
+    clear_highlights(highlight_map, data, data->num_columns);
+}
+
+void raster_fill(struct Raster* raster, int x, int y, int w, int h, Color_t color) {
+    int x0 = clamp(x, 0, raster->width);
+    int x1 = clamp(x + w, 0, raster->width);
+    int y0 = clamp(y, 0, raster->height);
+    int y1 = clamp(y + h, 0, raster->height);
+    uint32_t pixel = color_to_argb(color);
+    for (int row = y0; row < y1; row++) {
+        uint32_t* line = raster->pixels + (size_t)row * raster->width;
+        for (int col = x0; col < x1; col++) {
+            line[col] = pixel;
+        }
+    }
+}
+
+void raster_histogram(struct Raster* raster,
+                      const int* counts,
+                      int num_buckets,
+                      int active,
+                      int x,
+                      int y,
+                      int w,
+                      int h) {
+    if (num_buckets > HISTOGRAM_MAX_BUCKETS) {
+        num_buckets = HISTOGRAM_MAX_BUCKETS;
+    }
+    int max_count = 0;
+    for (int b = 0; b < num_buckets; b++) {
+        max_count = counts[b] > max_count ? counts[b] : max_count;
+    }
+    if (max_count == 0) {
+        return;
+    }
+
+    for (int b = 0; b < num_buckets; b++) {
+        // same layout as draw_histogram
+        int bar_x = x + b * w / num_buckets;
+        int bar_w = x + (b + 1) * w / num_buckets - bar_x;
+        int bar_h = (int)((long long)counts[b] * h / max_count);
+        raster_fill(raster, bar_x, y, bar_w > 0 ? bar_w : 1, bar_h, b == active ? SECONDARY : MUTED);
+    }
+}
+
+void raster_text(struct Raster* raster, int x, int y, int scale, const char* text, Color_t color) {
+    int pen_x = x;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            pen_x = x;
+            y += FONT_LINE_HEIGHT * scale;
+            continue;
+        }
+        const uint8_t* glyph = font_glyph(*c);
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            for (int col = 0; col < FONT_WIDTH; col++) {
+                if (glyph[row] & (1 << (FONT_WIDTH - 1 - col))) {
+                    raster_fill(raster, pen_x + col * scale, y + row * scale, scale, scale, color);
+                }
+            }
+        }
+        pen_x += FONT_ADVANCE * scale;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Description of the column chart and a software rasterizer for it. Nothing
+// in here depends on SDL so it can also be used without a window.
+
+typedef struct Color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} Color_t;
+
+extern const Color_t PRIMARY;
+extern const Color_t SECONDARY;
+extern const Color_t TERTIARY;
+extern const Color_t LIGHT;
+extern const Color_t DARK;
+extern const Color_t MUTED; // min..max band of envelope columns
+
+// one color per worker thread of the parallel algorithms
+#define NUM_WORKER_COLORS 4
+extern const Color_t WORKER_COLORS[NUM_WORKER_COLORS];
+
+// columns are at least this high and leave this fraction of the window free
+#define COLUMN_MIN_HEIGHT 20
+#define COLUMN_HEADROOM 6
+// most buckets a histogram draws, the rest are left out
+#define HISTOGRAM_MAX_BUCKETS 256
+
+Color_t highlight_color(struct Highlight highlight);
+
+struct ColumnDrawData {
+    // coordinate system: (0, 0) is the top-left corner,
+    // x increases to the right, y increases downwards
+    int x; // x-coordinate of the first column
+    int y; // y-coordinate of the first column
+    int w; // width of a column
+    int num_columns;
+    int num_colored_columns;
+    int* columns;
+    // the color at color[i] will be applied to the column
+    // at colored_column_indices[i]
+    int* colored_columns_indices;
+    Color_t* colors;
+    // when set, each column is the envelope of a bucket of values, the bar
+    // is drawn up to column_min[i], a MUTED band from there up to columns[i]
+    // (the maximum) and a line at column_mean[i]
+    int* column_min;
+    int* column_mean;
+};
+
+// map[i] is set to the index into data->colors of the highlight of column i,
+// the first highlight of a column wins, map must hold num_columns entries
+// that are -1 for every column that is not highlighted
+void mark_highlights(int* map, const struct ColumnDrawData* data, int num_columns);
+// undo mark_highlights, leaving every entry of map at -1
+void clear_highlights(int* map, const struct ColumnDrawData* data, int num_columns);
+Color_t column_color(const int* map, const struct ColumnDrawData* data, int i);
+
+// 32-bit pixels packed as 0xAARRGGBB (SDL_PIXELFORMAT_ARGB8888)
+struct Raster {
+    uint32_t* pixels;
+    int width;
+    int height;
+};
+
+bool raster_init(struct Raster* raster, int width, int height);
+void raster_free(struct Raster* raster);
+uint32_t color_to_argb(Color_t color);
+
+// x range [x, x + w) covered by column i, clipped to the raster
+void raster_column_span(const struct Raster* raster, const struct ColumnDrawData* data, int i, int* x, int* w);
+// redraw the full height of column i on a DARK background, highlight_map as
+// for mark_highlights, highlighted envelope columns are drawn as a plain bar
+// up to the maximum
+void raster_column(struct Raster* raster, const struct ColumnDrawData* data, const int* highlight_map, int i);
+// redraw the whole chart, highlight_map as for mark_highlights
+void raster_columns(struct Raster* raster, const struct ColumnDrawData* data, int* highlight_map);
+// bucket counters as bars hanging from the top of the w x h area at (x, y),
+// the same chart as draw_histogram
+void raster_histogram(struct Raster* raster,
+                      const int* counts,
+                      int num_buckets,
+                      int active,
+                      int x,
+                      int y,
+                      int w,
+                      int h);
+// text in the 5x7 font of font.h with its top-left corner at (x, y), every
+// font pixel drawn as a scale x scale square, '\n' starts a new line
+void raster_text(struct Raster* raster, int x, int y, int scale, const char* text, Color_t color);
+// fill the w x h area at (x, y), clipped to the raster
+void raster_fill(struct Raster* raster, int x, int y, int w, int h, Color_t color);
@@ -0,0 +1,315 @@
+#include "render.h"
+#include "font.h"
+#include <stdlib.h>
+#include <string.h>
+
+// writes tracked between two frames before the streaming backend gives up
+// and redraws the whole texture
+#define WRITE_LOG_CAPACITY (1 << 16)
+// rects draw_text collects before submitting them
+#define TEXT_RECTS 256
+
+static bool color_equal(Color_t a, Color_t b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static SDL_Rect column_rect(const struct ColumnDrawData* data, int i) {
+    SDL_Rect column = {data->x + i * data->w, data->y, data->w, -data->columns[i]};
+    return column;
+}
+
+static void fill_rects(SDL_Renderer* const renderer, const SDL_Rect* rects, int count, Color_t color) {
+    if (count == 0) {
+        return;
+    }
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRects(renderer, rects, count);
+}
+
+static void free_streaming(struct ColumnRenderer* column_renderer) {
+    free(column_renderer->drawn_frame);
+    free(column_renderer->prev_highlights);
+    if (column_renderer->texture != NULL) {
+        SDL_DestroyTexture(column_renderer->texture);
+    }
+    raster_free(&column_renderer->raster);
+    write_log_free(&column_renderer->write_log);
+    column_renderer->drawn_frame = NULL;
+    column_renderer->prev_highlights = NULL;
+    column_renderer->texture = NULL;
+    column_renderer->backend = BACKEND_RECTS;
+}
+
+bool column_renderer_init(struct ColumnRenderer* column_renderer, int num_columns) {
+    memset(column_renderer, 0, sizeof(*column_renderer));
+    column_renderer->backend = BACKEND_RECTS;
+    column_renderer->capacity = num_columns;
+    // envelope columns take up to three rects each
+    column_renderer->rects = malloc(3 * num_columns * sizeof(SDL_Rect));
+    column_renderer->highlight_map = malloc(num_columns * sizeof(int));
+    if (column_renderer->rects == NULL || column_renderer->highlight_map == NULL) {
+        column_renderer_free(column_renderer);
+        return false;
+    }
+
+    for (int i = 0; i < num_columns; i++) {
+        column_renderer->highlight_map[i] = -1;
+    }
+    return true;
+}
+
+bool column_renderer_init_streaming(struct ColumnRenderer* column_renderer,
+                                    SDL_Renderer* const renderer,
+                                    int width,
+                                    int height) {
+    int n = column_renderer->capacity;
+    column_renderer->texture = SDL_CreateTexture(renderer,
+                                                 SDL_PIXELFORMAT_ARGB8888,
+                                                 SDL_TEXTUREACCESS_STREAMING,
+                                                 width,
+                                                 height);
+    column_renderer->drawn_frame = calloc(n, sizeof(unsigned int));
+    column_renderer->prev_highlights = malloc(n * sizeof(int));
+    bool ok = column_renderer->texture != NULL &&
+              column_renderer->drawn_frame != NULL &&
+              column_renderer->prev_highlights != NULL &&
+              raster_init(&column_renderer->raster, width, height) &&
+              write_log_init(&column_renderer->write_log, WRITE_LOG_CAPACITY);
+    column_renderer->frame = 0;
+    column_renderer->num_prev_highlights = 0;
+    column_renderer->needs_full_redraw = true;
+    if (!ok) {
+        free_streaming(column_renderer);
+    }
+    return ok;
+}
+
+void column_renderer_free(struct ColumnRenderer* column_renderer) {
+    free_streaming(column_renderer);
+    free(column_renderer->rects);
+    free(column_renderer->highlight_map);
+    memset(column_renderer, 0, sizeof(*column_renderer));
+}
+
+void column_renderer_invalidate(struct ColumnRenderer* column_renderer) {
+    column_renderer->needs_full_redraw = true;
+}
+
+static void draw_columns_rects(SDL_Renderer* const renderer,
+                               struct ColumnRenderer* column_renderer,
+                               const struct ColumnDrawData* data,
+                               int num_columns) {
+    int* map = column_renderer->highlight_map;
+    SDL_Rect* rects = column_renderer->rects;
+
+    // every column that is not highlighted shares the same color, for
+    // envelope columns the bands are drawn first so the mean lines end up on
+    // top of them
+    int count = 0;
+    if (data->column_min != NULL) {
+        for (int i = 0; i < num_columns; i++) {
+            if (map[i] < 0 && data->columns[i] > data->column_min[i]) {
+                SDL_Rect band = {data->x + i * data->w,
+                                 data->y - data->column_min[i],
+                                 data->w,
+                                 data->column_min[i] - data->columns[i]};
+                rects[count++] = band;
+            }
+        }
+        fill_rects(renderer, rects, count, MUTED);
+        count = 0;
+
+        for (int i = 0; i < num_columns; i++) {
+            if (map[i] < 0) {
+                SDL_Rect bar = {data->x + i * data->w, data->y, data->w, -data->column_min[i]};
+                rects[count++] = bar;
+                if (data->columns[i] > data->column_min[i]) {
+                    SDL_Rect mean = {data->x + i * data->w, data->y - data->column_mean[i], data->w, -1};
+                    rects[count++] = mean;
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < num_columns; i++) {
+            if (map[i] < 0) {
+                rects[count++] = column_rect(data, i);
+            }
+        }
+    }
+    fill_rects(renderer, rects, count, LIGHT);
+
+    // the highlighted columns are grouped by color, highlights are few so
+    // comparing every pair of them is cheaper than anything fancier
+    for (int j = 0; j < data->num_colored_columns; j++) {
+        bool drawn = false;
+        for (int k = 0; k < j; k++) {
+            drawn = drawn || color_equal(data->colors[k], data->colors[j]);
+        }
+        if (drawn) {
+            continue;
+        }
+
+        int group_count = 0;
+        for (int k = j; k < data->num_colored_columns; k++) {
+            int idx = data->colored_columns_indices[k];
+            if (color_equal(data->colors[k], data->colors[j]) &&
+                idx >= 0 && idx < num_columns && map[idx] == k) {
+                rects[count + group_count++] = column_rect(data, idx);
+            }
+        }
+        fill_rects(renderer, rects + count, group_count, data->colors[j]);
+    }
+}
+
+// re-rasterize column i and upload it, unless it was already done this frame
+static void redraw_column(struct ColumnRenderer* column_renderer,
+                          const struct ColumnDrawData* data,
+                          int num_columns,
+                          int i) {
+    if (i < 0 || i >= num_columns || column_renderer->drawn_frame[i] == column_renderer->frame) {
+        return;
+    }
+    column_renderer->drawn_frame[i] = column_renderer->frame;
+
+    struct Raster* raster = &column_renderer->raster;
+    raster_column(raster, data, column_renderer->highlight_map, i);
+
+    int x, w;
+    raster_column_span(raster, data, i, &x, &w);
+    if (w > 0) {
+        SDL_Rect rect = {x, 0, w, raster->height};
+        SDL_UpdateTexture(column_renderer->texture,
+                          &rect,
+                          raster->pixels + x,
+                          raster->width * sizeof(uint32_t));
+    }
+}
+
+static void draw_columns_streaming(SDL_Renderer* const renderer,
+                                   struct ColumnRenderer* column_renderer,
+                                   const struct ColumnDrawData* data,
+                                   int num_columns) {
+    struct Raster* raster = &column_renderer->raster;
+    struct WriteLog* log = &column_renderer->write_log;
+
+    if (column_renderer->needs_full_redraw || log->overflow) {
+        // raster_columns marks the highlights itself
+        clear_highlights(column_renderer->highlight_map, data, num_columns);
+        raster_columns(raster, data, column_renderer->highlight_map);
+        mark_highlights(column_renderer->highlight_map, data, num_columns);
+        SDL_UpdateTexture(column_renderer->texture, NULL, raster->pixels, raster->width * sizeof(uint32_t));
+        column_renderer->needs_full_redraw = false;
+    } else {
+        if (++column_renderer->frame == 0) {
+            // the frame counter wrapped around, forget every stamp
+            memset(column_renderer->drawn_frame, 0, column_renderer->capacity * sizeof(unsigned int));
+            column_renderer->frame = 1;
+        }
+
+        // columns written by the algorithm, columns that lost their
+        // highlight and columns that gained one
+        for (int k = 0; k < log->len; k++) {
+            redraw_column(column_renderer, data, num_columns, log->indices[k]);
+        }
+        for (int k = 0; k < column_renderer->num_prev_highlights; k++) {
+            redraw_column(column_renderer, data, num_columns, column_renderer->prev_highlights[k]);
+        }
+        for (int k = 0; k < data->num_colored_columns; k++) {
+            redraw_column(column_renderer, data, num_columns, data->colored_columns_indices[k]);
+        }
+    }
+
+    int num_highlights = data->num_colored_columns < num_columns ? data->num_colored_columns : num_columns;
+    memcpy(column_renderer->prev_highlights, data->colored_columns_indices, num_highlights * sizeof(int));
+    column_renderer->num_prev_highlights = num_highlights;
+    write_log_clear(log);
+
+    SDL_RenderCopy(renderer, column_renderer->texture, NULL, NULL);
+}
+
+void draw_columns(SDL_Renderer* const renderer,
+                  struct ColumnRenderer* column_renderer,
+                  struct ColumnDrawData data) {
+    int num_columns = data.num_columns < column_renderer->capacity ? data.num_columns : column_renderer->capacity;
+    data.num_columns = num_columns;
+
+    mark_highlights(column_renderer->highlight_map, &data, num_columns);
+    if (column_renderer->backend == BACKEND_STREAMING && column_renderer->texture != NULL) {
+        draw_columns_streaming(renderer, column_renderer, &data, num_columns);
+    } else {
+        draw_columns_rects(renderer, column_renderer, &data, num_columns);
+    }
+    // leave the map cleared for the next frame
+    clear_highlights(column_renderer->highlight_map, &data, num_columns);
+
+    SDL_SetRenderDrawColor(renderer, DARK.r, DARK.g, DARK.b, DARK.a);
+}
+
+void draw_histogram(SDL_Renderer* const renderer, const int* counts, int num_buckets, int active, SDL_Rect area) {
+    if (num_buckets > HISTOGRAM_MAX_BUCKETS) {
+        num_buckets = HISTOGRAM_MAX_BUCKETS;
+    }
+    int max_count = 0;
+    for (int b = 0; b < num_buckets; b++) {
+        max_count = counts[b] > max_count ? counts[b] : max_count;
+    }
+    if (max_count == 0) {
+        return;
+    }
+
+    SDL_Rect rects[HISTOGRAM_MAX_BUCKETS];
+    int count = 0;
+    SDL_Rect active_rect = {0, 0, 0, 0};
+    for (int b = 0; b < num_buckets; b++) {
+        // spread the rounding error over the buckets instead of leaving a
+        // gap at the right edge
+        int x = area.x + b * area.w / num_buckets;
+        int w = area.x + (b + 1) * area.w / num_buckets - x;
+        int h = (int)((long long)counts[b] * area.h / max_count);
+        SDL_Rect bar = {x, area.y, w > 0 ? w : 1, h};
+        if (b == active) {
+            active_rect = bar;
+        } else if (h > 0) {
+            rects[count++] = bar;
+        }
+    }
+    fill_rects(renderer, rects, count, MUTED);
+    fill_rects(renderer, &active_rect, active_rect.h > 0 ? 1 : 0, SECONDARY);
+    SDL_SetRenderDrawColor(renderer, DARK.r, DARK.g, DARK.b, DARK.a);
+}
+
+void draw_text(SDL_Renderer* const renderer, int x, int y, int scale, const char* text, Color_t color) {
+    SDL_Rect rects[TEXT_RECTS];
+    int count = 0;
+    int pen_x = x;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            pen_x = x;
+            y += FONT_LINE_HEIGHT * scale;
+            continue;
+        }
+        const uint8_t* glyph = font_glyph(*c);
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            // one rect per run of set pixels in the row
+            int col = 0;
+            while (col < FONT_WIDTH) {
+                if (!(glyph[row] & (1 << (FONT_WIDTH - 1 - col)))) {
+                    col++;
+                    continue;
+                }
+                int start = col;
+                while (col < FONT_WIDTH && (glyph[row] & (1 << (FONT_WIDTH - 1 - col)))) {
+                    col++;
+                }
+                if (count == TEXT_RECTS) {
+                    fill_rects(renderer, rects, count, color);
+                    count = 0;
+                }
+                rects[count++] = (SDL_Rect){pen_x + start * scale, y + row * scale, (col - start) * scale, scale};
+            }
+        }
+        pen_x += FONT_ADVANCE * scale;
+    }
+    fill_rects(renderer, rects, count, color);
+    SDL_SetRenderDrawColor(renderer, DARK.r, DARK.g, DARK.b, DARK.a);
+}
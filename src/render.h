@@ -0,0 +1,59 @@
+#pragma once
+
+#include "algorithms.h"
+#include "raster.h"
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+enum RenderBackend {
+    // every column is drawn as a rect each frame
+    BACKEND_RECTS,
+    // the chart is kept in a streaming texture and only the columns that
+    // were written or (un)highlighted since the last frame are redrawn
+    BACKEND_STREAMING,
+};
+
+// Buffers preallocated for draw_columns so that a frame submits one
+// SDL_RenderFillRects call per color instead of one call per column, and
+// the state of the streaming texture backend
+struct ColumnRenderer {
+    enum RenderBackend backend;
+    int capacity;       // number of columns the buffers can hold
+    SDL_Rect* rects;    // column rects, grouped by color while drawing
+    int* highlight_map; // index into ColumnDrawData.colors per column, or -1
+
+    // streaming backend, only set up by column_renderer_init_streaming
+    SDL_Texture* texture;
+    struct Raster raster;
+    struct WriteLog write_log;  // to be filled by the active algorithm
+    unsigned int* drawn_frame;  // last frame each column was redrawn in
+    unsigned int frame;
+    int* prev_highlights;       // columns highlighted in the previous frame
+    int num_prev_highlights;
+    bool needs_full_redraw;
+};
+
+bool column_renderer_init(struct ColumnRenderer* column_renderer, int num_columns);
+// create the texture for the streaming backend, the size is the size of the
+// render target
+bool column_renderer_init_streaming(struct ColumnRenderer* column_renderer,
+                                    SDL_Renderer* const renderer,
+                                    int width,
+                                    int height);
+void column_renderer_free(struct ColumnRenderer* column_renderer);
+// the columns changed without going through the write log (e.g. on reset),
+// the streaming backend redraws everything on the next frame
+void column_renderer_invalidate(struct ColumnRenderer* column_renderer);
+
+void draw_columns(SDL_Renderer* const renderer,
+                  struct ColumnRenderer* column_renderer,
+                  struct ColumnDrawData data);
+
+// bucket counters of a radix sort as bars hanging from the top of area,
+// scaled to the largest counter, the active bucket (-1 for none) is drawn
+// in the SECONDARY color
+void draw_histogram(SDL_Renderer* const renderer, const int* counts, int num_buckets, int active, SDL_Rect area);
+
+// text in the 5x7 font of font.h with its top-left corner at (x, y), the
+// same glyphs as raster_text, each font pixel is a scale x scale square
+void draw_text(SDL_Renderer* const renderer, int x, int y, int scale, const char* text, Color_t color);
@@ -0,0 +1,96 @@
+#include "scheduler.h"
+#include <errno.h>
+#include <time.h>
+
+// weight of the newest sample in the moving averages
+#define AVERAGE_WEIGHT 0.1
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// sleep until the monotonic clock reads deadline_ms, absolute so that the
+// time spent getting here does not add up over the frames
+static void sleep_until(double deadline_ms) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ms / 1000.0);
+    ts.tv_nsec = (long)((deadline_ms - ts.tv_sec * 1000.0) * 1e6);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static double average(double avg, double sample) {
+    return avg + AVERAGE_WEIGHT * (sample - avg);
+}
+
+void frame_scheduler_init(struct FrameScheduler* scheduler, int fps, bool vsync) {
+    scheduler->frame_ms = 1000.0 / (fps > 0 ? fps : 60);
+    scheduler->vsync = vsync;
+    scheduler->frame_start = now_ms();
+    scheduler->draw_start = scheduler->frame_start;
+    scheduler->draw_ms = 0.0;
+    scheduler->frame_steps = 0;
+    scheduler->frame_time_ms = scheduler->frame_ms;
+    scheduler->steps_per_sec = 0.0;
+    scheduler->fps = 0.0;
+    scheduler->frames = 0;
+    scheduler->dropped_frames = 0;
+    scheduler->window_start = scheduler->frame_start;
+    scheduler->window_steps = 0;
+    scheduler->window_frames = 0;
+}
+
+void frame_scheduler_begin(struct FrameScheduler* scheduler) {
+    scheduler->frame_start = now_ms();
+    scheduler->frame_steps = 0;
+}
+
+double frame_scheduler_budget_ms(const struct FrameScheduler* scheduler) {
+    double elapsed = now_ms() - scheduler->frame_start;
+    double budget = scheduler->frame_ms * (1.0 - SCHEDULER_MARGIN) - elapsed - scheduler->draw_ms;
+    return budget > 0.0 ? budget : 0.0;
+}
+
+void frame_scheduler_draw(struct FrameScheduler* scheduler, long long steps) {
+    scheduler->frame_steps = steps;
+    scheduler->draw_start = now_ms();
+}
+
+void frame_scheduler_present(struct FrameScheduler* scheduler) {
+    // presenting is left out, with vsync it includes waiting for the display
+    scheduler->draw_ms = average(scheduler->draw_ms, now_ms() - scheduler->draw_start);
+}
+
+void frame_scheduler_end(struct FrameScheduler* scheduler) {
+    double deadline = scheduler->frame_start + scheduler->frame_ms;
+    double now = now_ms();
+    if (!scheduler->vsync && now < deadline) {
+        sleep_until(deadline);
+        now = now_ms();
+    }
+
+    double frame_time = now - scheduler->frame_start;
+    scheduler->frame_time_ms = average(scheduler->frame_time_ms, frame_time);
+    if (frame_time > SCHEDULER_DROP_FACTOR * scheduler->frame_ms) {
+        // the frames that would have been shown while this one overran
+        scheduler->dropped_frames += (long long)(frame_time / scheduler->frame_ms + 0.5) - 1;
+    }
+    scheduler->frames++;
+
+    scheduler->window_steps += scheduler->frame_steps;
+    scheduler->window_frames++;
+    double window = now - scheduler->window_start;
+    if (window >= SCHEDULER_METRICS_MS) {
+        scheduler->steps_per_sec = scheduler->window_steps * 1000.0 / window;
+        scheduler->fps = scheduler->window_frames * 1000.0 / window;
+        scheduler->window_start = now;
+        scheduler->window_steps = 0;
+        scheduler->window_frames = 0;
+    }
+}
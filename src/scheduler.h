@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Paces the frames of the visualizer and decides how much of each frame the
+// algorithm may step. A frame is begin -> events and steps -> draw -> present
+// -> end. Without vsync, end sleeps until the frame's deadline on the
+// monotonic clock. With vsync, presenting blocks until the next refresh
+// instead. Either way the stepping budget is what is left of the frame after
+// the events and the average cost of drawing it.
+
+// fraction of the frame kept free for jitter in the stepping budget
+#define SCHEDULER_MARGIN 0.1
+// a frame longer than this many target frames drops the frames it overran
+#define SCHEDULER_DROP_FACTOR 1.5
+// how often the throughput metrics are refreshed
+#define SCHEDULER_METRICS_MS 500.0
+
+struct FrameScheduler {
+    double frame_ms; // target frame time
+    bool vsync;      // presenting waits for the display, end never sleeps
+    double frame_start;
+    double draw_start;
+    double draw_ms; // moving average of the time spent drawing a frame
+    long long frame_steps;
+
+    // live metrics
+    double frame_time_ms; // moving average of the whole frame time
+    double steps_per_sec;
+    double fps;
+    long long frames;
+    long long dropped_frames;
+
+    // window the throughput metrics are averaged over
+    double window_start;
+    long long window_steps;
+    long long window_frames;
+};
+
+// fps is the display refresh rate with vsync and the target otherwise
+void frame_scheduler_init(struct FrameScheduler* scheduler, int fps, bool vsync);
+void frame_scheduler_begin(struct FrameScheduler* scheduler);
+// milliseconds of the current frame left for stepping, 0 if there are none
+double frame_scheduler_budget_ms(const struct FrameScheduler* scheduler);
+// the frame took steps steps and drawing it starts
+void frame_scheduler_draw(struct FrameScheduler* scheduler, long long steps);
+// the frame is drawn and about to be presented
+void frame_scheduler_present(struct FrameScheduler* scheduler);
+// the frame was presented, sleeps until its deadline unless paced by vsync
+void frame_scheduler_end(struct FrameScheduler* scheduler);
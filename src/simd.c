@@ -0,0 +1,594 @@
+#include "simd.h"
+#include "algorithms.h"
+#include "small_sort.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+static inline int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+// ================== Scalar ==================
+static void merge_scalar(const int* a, int a_len, const int* b, int b_len, int* out) {
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    while (i < a_len && j < b_len) {
+        out[k++] = a[i] <= b[j] ? a[i++] : b[j++];
+    }
+    while (i < a_len) {
+        out[k++] = a[i++];
+    }
+    // when merging in front of b this copies the rest of b onto itself
+    while (j < b_len) {
+        out[k++] = b[j++];
+    }
+}
+
+static int partition_scalar(int* arr, int len, int pivot) {
+    int lt = 0;
+    for (int i = 0; i < len; i++) {
+        int value = arr[i];
+        if (value < pivot) {
+            arr[i] = arr[lt];
+            arr[lt++] = value;
+        }
+    }
+    return lt;
+}
+
+// move the len - left_write unplaced elements in buf to the gap
+// [left_write, right_write) of a vectorized partition, returns the number of
+// elements less than pivot in the whole array
+static int place_rest(int* arr, int left_write, int right_write, const int* buf, int len, int pivot) {
+    for (int i = 0; i < len; i++) {
+        if (buf[i] < pivot) {
+            arr[left_write++] = buf[i];
+        } else {
+            arr[--right_write] = buf[i];
+        }
+    }
+    return left_write;
+}
+
+#ifdef SIMD_X86
+// ================== Permutation tables ==================
+// PERM8[mask] moves the lanes set in mask to the front, in order, followed
+// by the other lanes, PERM4 is the same as a byte shuffle for 4 lanes
+static int32_t PERM8[256][8];
+static uint8_t PERM4[16][16];
+
+static void init_permutations(void) {
+    for (int mask = 0; mask < 256; mask++) {
+        int n = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int lane = 0; lane < 8; lane++) {
+                if (((mask >> lane) & 1) == (pass == 0)) {
+                    PERM8[mask][n++] = lane;
+                }
+            }
+        }
+    }
+    for (int mask = 0; mask < 16; mask++) {
+        int n = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int lane = 0; lane < 4; lane++) {
+                if (((mask >> lane) & 1) == (pass == 0)) {
+                    for (int byte = 0; byte < 4; byte++) {
+                        PERM4[mask][n++] = (uint8_t)(4 * lane + byte);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ================== SSE4.1 ==================
+#define SSE4 __attribute__((target("sse4.1")))
+
+// one compare-exchange stage, lanes set in mask take the maximum of the lane
+// and its partner, the others the minimum
+#define STAGE4(v, partner, mask)                                                    \
+    _mm_castps_si128(_mm_blend_ps(_mm_castsi128_ps(_mm_min_epi32(v, partner)),      \
+                                  _mm_castsi128_ps(_mm_max_epi32(v, partner)), mask))
+
+static inline SSE4 __m128i swap_pairs4(__m128i v) {
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline SSE4 __m128i swap_halves4(__m128i v) {
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+// sort a bitonic vector
+static inline SSE4 __m128i clean4(__m128i v) {
+    v = STAGE4(v, swap_halves4(v), 0xC);
+    return STAGE4(v, swap_pairs4(v), 0xA);
+}
+
+static inline SSE4 __m128i sort4(__m128i v) {
+    v = STAGE4(v, swap_pairs4(v), 0x6);
+    return clean4(v);
+}
+
+// merge the sorted vectors a and b, a gets the lower and b the upper half
+static inline SSE4 void merge4(__m128i* a, __m128i* b) {
+    __m128i reversed = _mm_shuffle_epi32(*b, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i lo = _mm_min_epi32(*a, reversed);
+    __m128i hi = _mm_max_epi32(*a, reversed);
+    *a = clean4(lo);
+    *b = clean4(hi);
+}
+
+// sort the bitonic sequence of 8 elements in a and b
+static inline SSE4 void clean8_sse4(__m128i* a, __m128i* b) {
+    __m128i lo = _mm_min_epi32(*a, *b);
+    __m128i hi = _mm_max_epi32(*a, *b);
+    *a = clean4(lo);
+    *b = clean4(hi);
+}
+
+// lanes past the end of the input are padded with INT_MAX, which sorts last
+// and is cut off again by store_partial4
+static inline SSE4 __m128i load_padded4(const int* p, int n) {
+    if (n >= 4) {
+        return _mm_loadu_si128((const __m128i*)p);
+    }
+    int buf[4];
+    for (int i = 0; i < 4; i++) {
+        buf[i] = i < n ? p[i] : INT_MAX;
+    }
+    return _mm_loadu_si128((const __m128i*)buf);
+}
+
+static inline SSE4 void store_partial4(int* p, __m128i v, int n) {
+    if (n >= 4) {
+        _mm_storeu_si128((__m128i*)p, v);
+    } else if (n > 0) {
+        int buf[4];
+        _mm_storeu_si128((__m128i*)buf, v);
+        memcpy(p, buf, n * sizeof(int));
+    }
+}
+
+static SSE4 void merge_sse4(const int* a, int a_len, const int* b, int b_len, int* out) {
+    if (a_len < 4 || b_len < 4) {
+        merge_scalar(a, a_len, b, b_len, out);
+        return;
+    }
+
+    // va and vb always hold the 8 smallest elements not written yet, the
+    // next vector is loaded from the input with the smaller head
+    int total = a_len + b_len;
+    __m128i va = _mm_loadu_si128((const __m128i*)a);
+    __m128i vb = _mm_loadu_si128((const __m128i*)b);
+    int ia = 4;
+    int ib = 4;
+    int written = 0;
+    while (true) {
+        merge4(&va, &vb);
+        store_partial4(out + written, va, total - written);
+        written += 4;
+        if (ia >= a_len && ib >= b_len) {
+            break;
+        }
+        if (ib >= b_len || (ia < a_len && a[ia] <= b[ib])) {
+            va = load_padded4(a + ia, a_len - ia);
+            ia += 4;
+        } else {
+            va = load_padded4(b + ib, b_len - ib);
+            ib += 4;
+        }
+    }
+    store_partial4(out + written, vb, total - written);
+}
+
+static SSE4 void sort_small_sse4(int* arr, int len) {
+    __m128i v0 = sort4(load_padded4(arr, len));
+    __m128i v1 = sort4(load_padded4(arr + 4, len - 4));
+    __m128i v2 = sort4(load_padded4(arr + 8, len - 8));
+    __m128i v3 = sort4(load_padded4(arr + 12, len - 12));
+    merge4(&v0, &v1);
+    merge4(&v2, &v3);
+
+    // merge the sorted runs (v0, v1) and (v2, v3) by reversing the second
+    // one, which makes the lower and the upper halves bitonic
+    __m128i r2 = _mm_shuffle_epi32(v3, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i r3 = _mm_shuffle_epi32(v2, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i lo0 = _mm_min_epi32(v0, r2);
+    __m128i lo1 = _mm_min_epi32(v1, r3);
+    __m128i hi0 = _mm_max_epi32(v0, r2);
+    __m128i hi1 = _mm_max_epi32(v1, r3);
+    clean8_sse4(&lo0, &lo1);
+    clean8_sse4(&hi0, &hi1);
+
+    store_partial4(arr, lo0, len);
+    store_partial4(arr + 4, lo1, len - 4);
+    store_partial4(arr + 8, hi0, len - 8);
+    store_partial4(arr + 12, hi1, len - 12);
+}
+
+static SSE4 int partition_sse4(int* arr, int len, int pivot) {
+    if (len < 8) {
+        return partition_scalar(arr, len, pivot);
+    }
+
+    // the first and the last vector are kept in registers, which leaves room
+    // to write a whole vector to both ends, every iteration reads from the
+    // end with less room left so neither write can reach unread elements
+    __m128i pivots = _mm_set1_epi32(pivot);
+    int saved[8];
+    _mm_storeu_si128((__m128i*)saved, _mm_loadu_si128((const __m128i*)arr));
+    _mm_storeu_si128((__m128i*)(saved + 4), _mm_loadu_si128((const __m128i*)(arr + len - 4)));
+    int left_read = 4;
+    int right_read = len - 4;
+    int left_write = 0;
+    int right_write = len;
+    while (right_read - left_read >= 4) {
+        __m128i v;
+        if (left_read - left_write <= right_write - right_read) {
+            v = _mm_loadu_si128((const __m128i*)(arr + left_read));
+            left_read += 4;
+        } else {
+            right_read -= 4;
+            v = _mm_loadu_si128((const __m128i*)(arr + right_read));
+        }
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(pivots, v)));
+        int n = __builtin_popcount(mask);
+        __m128i p = _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i*)PERM4[mask]));
+        _mm_storeu_si128((__m128i*)(arr + left_write), p);
+        _mm_storeu_si128((__m128i*)(arr + right_write - 4), p);
+        left_write += n;
+        right_write -= 4 - n;
+    }
+
+    int rest[12];
+    int num_rest = right_read - left_read;
+    memcpy(rest, arr + left_read, num_rest * sizeof(int));
+    memcpy(rest + num_rest, saved, sizeof(saved));
+    return place_rest(arr, left_write, right_write, rest, num_rest + 8, pivot);
+}
+
+// ================== AVX2 ==================
+#define AVX2 __attribute__((target("avx2")))
+
+#define STAGE8(v, partner, mask) \
+    _mm256_blend_epi32(_mm256_min_epi32(v, partner), _mm256_max_epi32(v, partner), mask)
+
+static inline AVX2 __m256i swap_pairs8(__m256i v) {
+    return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline AVX2 __m256i swap_quads8(__m256i v) {
+    return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static inline AVX2 __m256i swap_halves8(__m256i v) {
+    return _mm256_permute2x128_si256(v, v, 1);
+}
+
+// sort a bitonic vector
+static inline AVX2 __m256i clean8(__m256i v) {
+    v = STAGE8(v, swap_halves8(v), 0xF0);
+    v = STAGE8(v, swap_quads8(v), 0xCC);
+    return STAGE8(v, swap_pairs8(v), 0xAA);
+}
+
+// bitonic sorting network, sorts pairs and then quads in alternating
+// directions so that each half of the vector becomes bitonic
+static inline AVX2 __m256i sort8(__m256i v) {
+    v = STAGE8(v, swap_pairs8(v), 0x66);
+    v = STAGE8(v, swap_quads8(v), 0x3C);
+    v = STAGE8(v, swap_pairs8(v), 0x5A);
+    return clean8(v);
+}
+
+// merge the sorted vectors a and b, a gets the lower and b the upper half
+static inline AVX2 void merge8(__m256i* a, __m256i* b) {
+    __m256i reversed = _mm256_permutevar8x32_epi32(*b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    __m256i lo = _mm256_min_epi32(*a, reversed);
+    __m256i hi = _mm256_max_epi32(*a, reversed);
+    *a = clean8(lo);
+    *b = clean8(hi);
+}
+
+static inline AVX2 __m256i load_padded8(const int* p, int n) {
+    if (n >= 8) {
+        return _mm256_loadu_si256((const __m256i*)p);
+    }
+    int buf[8];
+    for (int i = 0; i < 8; i++) {
+        buf[i] = i < n ? p[i] : INT_MAX;
+    }
+    return _mm256_loadu_si256((const __m256i*)buf);
+}
+
+static inline AVX2 void store_partial8(int* p, __m256i v, int n) {
+    if (n >= 8) {
+        _mm256_storeu_si256((__m256i*)p, v);
+    } else if (n > 0) {
+        int buf[8];
+        _mm256_storeu_si256((__m256i*)buf, v);
+        memcpy(p, buf, n * sizeof(int));
+    }
+}
+
+static AVX2 void merge_avx2(const int* a, int a_len, const int* b, int b_len, int* out) {
+    if (a_len < 8 || b_len < 8) {
+        merge_scalar(a, a_len, b, b_len, out);
+        return;
+    }
+
+    // same scheme as merge_sse4 with twice the width
+    int total = a_len + b_len;
+    __m256i va = _mm256_loadu_si256((const __m256i*)a);
+    __m256i vb = _mm256_loadu_si256((const __m256i*)b);
+    int ia = 8;
+    int ib = 8;
+    int written = 0;
+    while (true) {
+        merge8(&va, &vb);
+        store_partial8(out + written, va, total - written);
+        written += 8;
+        if (ia >= a_len && ib >= b_len) {
+            break;
+        }
+        if (ib >= b_len || (ia < a_len && a[ia] <= b[ib])) {
+            va = load_padded8(a + ia, a_len - ia);
+            ia += 8;
+        } else {
+            va = load_padded8(b + ib, b_len - ib);
+            ib += 8;
+        }
+    }
+    store_partial8(out + written, vb, total - written);
+}
+
+static AVX2 void sort_small_avx2(int* arr, int len) {
+    __m256i a = sort8(load_padded8(arr, len));
+    if (len <= 8) {
+        store_partial8(arr, a, len);
+        return;
+    }
+    __m256i b = sort8(load_padded8(arr + 8, len - 8));
+    merge8(&a, &b);
+    store_partial8(arr, a, len);
+    store_partial8(arr + 8, b, len - 8);
+}
+
+static AVX2 int partition_avx2(int* arr, int len, int pivot) {
+    if (len < 16) {
+        return partition_scalar(arr, len, pivot);
+    }
+
+    // same scheme as partition_sse4 with twice the width
+    __m256i pivots = _mm256_set1_epi32(pivot);
+    int saved[16];
+    _mm256_storeu_si256((__m256i*)saved, _mm256_loadu_si256((const __m256i*)arr));
+    _mm256_storeu_si256((__m256i*)(saved + 8), _mm256_loadu_si256((const __m256i*)(arr + len - 8)));
+    int left_read = 8;
+    int right_read = len - 8;
+    int left_write = 0;
+    int right_write = len;
+    while (right_read - left_read >= 8) {
+        __m256i v;
+        if (left_read - left_write <= right_write - right_read) {
+            v = _mm256_loadu_si256((const __m256i*)(arr + left_read));
+            left_read += 8;
+        } else {
+            right_read -= 8;
+            v = _mm256_loadu_si256((const __m256i*)(arr + right_read));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(pivots, v)));
+        int n = __builtin_popcount(mask);
+        __m256i p = _mm256_permutevar8x32_epi32(v, _mm256_loadu_si256((const __m256i*)PERM8[mask]));
+        _mm256_storeu_si256((__m256i*)(arr + left_write), p);
+        _mm256_storeu_si256((__m256i*)(arr + right_write - 8), p);
+        left_write += n;
+        right_write -= 8 - n;
+    }
+
+    int rest[24];
+    int num_rest = right_read - left_read;
+    memcpy(rest, arr + left_read, num_rest * sizeof(int));
+    memcpy(rest + num_rest, saved, sizeof(saved));
+    return place_rest(arr, left_write, right_write, rest, num_rest + 16, pivot);
+}
+#endif
+
+// ================== Dispatch ==================
+struct Kernels {
+    void (*merge)(const int* a, int a_len, const int* b, int b_len, int* out);
+    int (*partition)(int* arr, int len, int pivot);
+    void (*sort_small)(int* arr, int len);
+};
+
+static const struct Kernels KERNELS[NUM_SIMD_LEVELS] = {
+    [SIMD_SCALAR] = {merge_scalar, partition_scalar, insertion_sort},
+#ifdef SIMD_X86
+    [SIMD_SSE4] = {merge_sse4, partition_sse4, sort_small_sse4},
+    [SIMD_AVX2] = {merge_avx2, partition_avx2, sort_small_avx2},
+#endif
+};
+
+static const char* const SIMD_LEVEL_NAMES[NUM_SIMD_LEVELS] = {
+    [SIMD_SCALAR] = "scalar",
+    [SIMD_SSE4] = "sse4",
+    [SIMD_AVX2] = "avx2",
+};
+
+static const struct Kernels* kernels = NULL;
+static enum SimdLevel current_level = SIMD_SCALAR;
+
+enum SimdLevel simd_detect(void) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SIMD_SSE4;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+bool simd_set_level(enum SimdLevel level) {
+    // every level implies the ones below it
+    if (level < 0 || level > simd_detect()) {
+        return false;
+    }
+#ifdef SIMD_X86
+    static bool tables_ready = false;
+    if (!tables_ready) {
+        init_permutations();
+        tables_ready = true;
+    }
+#endif
+    current_level = level;
+    kernels = &KERNELS[level];
+    return true;
+}
+
+static const struct Kernels* get_kernels(void) {
+    if (kernels == NULL) {
+        simd_set_level(simd_detect());
+    }
+    return kernels;
+}
+
+enum SimdLevel simd_level(void) {
+    get_kernels();
+    return current_level;
+}
+
+const char* simd_level_name(enum SimdLevel level) {
+    return level >= 0 && level < NUM_SIMD_LEVELS ? SIMD_LEVEL_NAMES[level] : "unknown";
+}
+
+bool parse_simd_level(const char* name, enum SimdLevel* level) {
+    for (int i = 0; i < NUM_SIMD_LEVELS; i++) {
+        if (strcmp(name, SIMD_LEVEL_NAMES[i]) == 0) {
+            *level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void simd_merge(const int* a, int a_len, const int* b, int b_len, int* out) {
+    get_kernels()->merge(a, a_len, b, b_len, out);
+}
+
+int simd_partition(int* arr, int len, int pivot) {
+    return get_kernels()->partition(arr, len, pivot);
+}
+
+void simd_sort_small(int* arr, int len) {
+    get_kernels()->sort_small(arr, len);
+}
+
+// ================== Sorts ==================
+bool simd_merge_sort(int* arr, int len) {
+    const struct Kernels* k = get_kernels();
+    for (int i = 0; i < len; i += SIMD_SMALL_SORT_MAX) {
+        k->sort_small(arr + i, min_int(SIMD_SMALL_SORT_MAX, len - i));
+    }
+    if (len <= SIMD_SMALL_SORT_MAX) {
+        return true;
+    }
+
+    int* scratch = malloc(len * sizeof(int));
+    if (scratch == NULL) {
+        return false;
+    }
+    int* src = arr;
+    int* dst = scratch;
+    for (long long width = SIMD_SMALL_SORT_MAX; width < len; width *= 2) {
+        for (long long left_idx = 0; left_idx < len; left_idx += 2 * width) {
+            int mid = (int)(left_idx + width < len ? left_idx + width : len);
+            int right_idx = (int)(left_idx + 2 * width < len ? left_idx + 2 * width : len);
+            k->merge(src + left_idx, mid - (int)left_idx, src + mid, right_idx - mid, dst + left_idx);
+        }
+        int* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != arr) {
+        memcpy(arr, src, len * sizeof(int));
+    }
+    free(scratch);
+    return true;
+}
+
+static void sift_down(int* heap, int node, int len) {
+    while (2 * node + 1 < len) {
+        int child = 2 * node + 1;
+        if (child + 1 < len && heap[child + 1] > heap[child]) {
+            child++;
+        }
+        if (heap[child] <= heap[node]) {
+            return;
+        }
+        int temp = heap[node];
+        heap[node] = heap[child];
+        heap[child] = temp;
+        node = child;
+    }
+}
+
+static void heap_sort(int* arr, int len) {
+    for (int node = len / 2 - 1; node >= 0; node--) {
+        sift_down(arr, node, len);
+    }
+    for (int end = len - 1; end > 0; end--) {
+        int temp = arr[0];
+        arr[0] = arr[end];
+        arr[end] = temp;
+        sift_down(arr, 0, end);
+    }
+}
+
+static void quick_sort_range(const struct Kernels* k, int* arr, int len, int budget) {
+    while (len > SIMD_SMALL_SORT_MAX) {
+        // too many levels means bad pivots, heapsort bounds the worst case
+        if (budget-- == 0) {
+            heap_sort(arr, len);
+            return;
+        }
+        int pivot = arr[quick_sort_pivot(arr, 0, len - 1, NULL)];
+        int lt = k->partition(arr, len, pivot);
+        if (lt == 0) {
+            // the pivot is the smallest element, all copies of it are done
+            int eq = pivot == INT_MAX ? len : k->partition(arr, len, pivot + 1);
+            arr += eq;
+            len -= eq;
+            continue;
+        }
+        // recurse into the smaller side only
+        if (lt < len - lt) {
+            quick_sort_range(k, arr, lt, budget);
+            arr += lt;
+            len -= lt;
+        } else {
+            quick_sort_range(k, arr + lt, len - lt, budget);
+            len = lt;
+        }
+    }
+    k->sort_small(arr, len);
+}
+
+void simd_quick_sort(int* arr, int len) {
+    int budget = 0;
+    for (int n = len; n > 1; n >>= 1) {
+        budget += 2;
+    }
+    quick_sort_range(get_kernels(), arr, len, budget);
+}
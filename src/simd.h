@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Vectorized kernels for int arrays with a scalar fallback. The kernels are
+// compiled for every instruction set and the best one the CPU supports is
+// picked at runtime, so the binary does not need to be built with -mavx2.
+//
+// - merge: bitonic merge network, two sorted vectors are merged in registers
+//   and the lower half is written out
+// - partition: every vector is compared with the pivot and compressed with a
+//   permutation table, in place by reading ahead from both ends
+// - sort_small: bitonic sorting network for blocks of up to
+//   SIMD_SMALL_SORT_MAX elements held in registers
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE4, // SSE4.1, 4 ints per vector
+    SIMD_AVX2, // 8 ints per vector
+    NUM_SIMD_LEVELS,
+};
+
+#define SIMD_SMALL_SORT_MAX 16
+
+// the best level supported by this CPU
+enum SimdLevel simd_detect(void);
+// the level used by the kernels, simd_detect() unless set with simd_set_level
+enum SimdLevel simd_level(void);
+// use the kernels of level, returns false if the CPU does not support it,
+// not thread safe, set the level before sorting on several threads
+bool simd_set_level(enum SimdLevel level);
+
+const char* simd_level_name(enum SimdLevel level);
+bool parse_simd_level(const char* name, enum SimdLevel* level);
+
+// merge the sorted arrays a and b into out, out must not overlap
+// a, it may overlap b if out + a_len == b (merging in front of b)
+void simd_merge(const int* a, int a_len, const int* b, int b_len, int* out);
+// move the elements less than pivot to the front, returns how many there are
+int simd_partition(int* arr, int len, int pivot);
+// sort len <= SIMD_SMALL_SORT_MAX elements
+void simd_sort_small(int* arr, int len);
+
+// one-shot sorts built from the kernels, simd_merge_sort returns false if
+// its scratch buffer could not be allocated
+bool simd_merge_sort(int* arr, int len);
+void simd_quick_sort(int* arr, int len);
@@ -0,0 +1,77 @@
+#include "small_sort.h"
+#include <stdbool.h>
+#include <string.h>
+
+void selection_sort(int* arr, int len) {
+    for (int i = 0; i < len - 1; i++) {
+        int min_idx = i;
+        int min_value = arr[i];
+        for (int j = i + 1; j < len; j++) {
+            int value = arr[j];
+            bool less = value < min_value;
+            min_value = less ? value : min_value;
+            min_idx = less ? j : min_idx;
+        }
+        arr[min_idx] = arr[i];
+        arr[i] = min_value;
+    }
+}
+
+void insertion_sort(int* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        int value = arr[i];
+        if (value >= arr[i - 1]) {
+            continue;
+        }
+        int j = 0;
+        if (value >= arr[0]) {
+            // arr[0] <= value stops the scan before it leaves the array
+            j = i - 1;
+            while (arr[j - 1] > value) {
+                j--;
+            }
+        }
+        memmove(arr + j + 1, arr + j, (i - j) * sizeof(int));
+        arr[j] = value;
+    }
+}
+
+int upper_bound(const int* arr, int len, int value) {
+    int lo = 0;
+    int hi = len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (arr[mid] > value) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+int lower_bound(const int* arr, int len, int value) {
+    int lo = 0;
+    int hi = len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (arr[mid] >= value) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void binary_insertion_sort(int* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        int value = arr[i];
+        if (value >= arr[i - 1]) {
+            continue;
+        }
+        int j = upper_bound(arr, i - 1, value);
+        memmove(arr + j + 1, arr + j, (i - j) * sizeof(int));
+        arr[j] = value;
+    }
+}
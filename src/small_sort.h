@@ -0,0 +1,22 @@
+#pragma once
+
+// One-shot quadratic sorts for short runs, the finishers of the hybrid
+// sorts (parallel, radix and simd) and the one-shot counterparts of the
+// stepwise selection and insertion sorts. They are meant for a few dozen
+// elements, where their small constant beats any O(n log n) sort.
+
+// selection sort whose minimum scan keeps the running minimum with
+// conditional moves instead of a branch on every comparison
+void selection_sort(int* arr, int len);
+// insertion sort that finds the slot of each element first and then shifts
+// the elements behind it with a single memmove, the first element serves as
+// the guard of the scan so the inner loop has a single condition
+void insertion_sort(int* arr, int len);
+// insertion sort that finds the slot by binary search, O(n log n)
+// comparisons but still O(n^2) moves
+void binary_insertion_sort(int* arr, int len);
+
+// first index in arr[0, len) whose element is greater than value
+int upper_bound(const int* arr, int len, int value);
+// first index in arr[0, len) whose element is greater than or equal to value
+int lower_bound(const int* arr, int len, int value);
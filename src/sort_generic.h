@@ -0,0 +1,262 @@
+// Type-specialized sorts generated by the preprocessor. The int algorithms
+// in algorithms.c drive the visualizer; this template instantiates the same
+// kind of stepwise merge sort and a one-shot intro sort for any element type
+// and ordering. The ordering is a macro, so every instantiation compiles its
+// comparisons inline without a comparator function pointer.
+//
+// No #pragma once, the header is included once per instantiation:
+//
+//   #define SORT_NAME u64           // prefix of the functions: u64_sort()
+//   #define SORT_STRUCT U64         // prefix of the state: struct U64MergeSortState
+//   #define SORT_TYPE uint64_t
+//   #define SORT_LESS(a, b) ((a) < (b))
+//   #define SORT_IMPLEMENTATION     // in exactly one .c file
+//   #include "sort_generic.h"
+//
+// SORT_LESS must be a strict weak ordering: it is false for equal elements,
+// and elements are equal when neither is less than the other. Without
+// SORT_IMPLEMENTATION only the state and the declarations are generated, a
+// translation unit includes each instantiation once, either way. All SORT_
+// macros are undefined at the end.
+
+#include "algorithms.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if !defined(SORT_NAME) || !defined(SORT_STRUCT) || !defined(SORT_TYPE) || !defined(SORT_LESS)
+#error "SORT_NAME, SORT_STRUCT, SORT_TYPE and SORT_LESS must be defined before including sort_generic.h"
+#endif
+
+#define SORT_CAT_(a, b) a##b
+#define SORT_CAT(a, b) SORT_CAT_(a, b)
+#define SORT_FN(name) SORT_CAT(SORT_NAME, SORT_CAT(_, name))
+#define SORT_STATE SORT_CAT(SORT_STRUCT, MergeSortState)
+
+// ranges of at most this many elements are finished by insertion sort
+#define SORT_INSERTION_THRESHOLD 16
+
+// Bottom-up merge sort, each step writes one element. A merge copies its
+// left run to scratch and merges it with the right run back into arr, once
+// the left run is used up the rest of the right run is already in place.
+struct SORT_STATE {
+    SORT_TYPE* arr;
+    SORT_TYPE* scratch;
+    int len;
+    int width;     // length of the runs merged in the current pass
+    int left_idx;  // first element of the current merge
+    int mid;       // first element of the right run
+    int right_idx; // one past the last element of the right run
+    int a_idx;     // next element of the left run, in scratch
+    int b_idx;     // next element of the right run, in arr
+    int out_idx;   // next position written
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void SORT_FN(merge_sort_init)(struct SORT_STATE* state, SORT_TYPE* arr, int len);
+void SORT_FN(merge_sort_free)(struct SORT_STATE* state);
+void SORT_FN(merge_sort_step)(struct SORT_STATE* state);
+long long SORT_FN(merge_sort_step_n)(struct SORT_STATE* state, long long n);
+void SORT_FN(insertion_sort)(SORT_TYPE* arr, int len);
+// one-shot intro sort: quick sort with a median of three pivot, heap sort
+// once the recursion gets too deep and insertion sort for small ranges
+void SORT_FN(sort)(SORT_TYPE* arr, int len);
+
+#ifdef SORT_IMPLEMENTATION
+
+// ================== Merge sort ==================
+// set up the merge at left_idx of the current pass, or move on to the next
+// pass, returns false when the array is sorted
+static bool SORT_FN(merge_begin)(struct SORT_STATE* state) {
+    while (state->width < state->len) {
+        if (state->left_idx + state->width < state->len) {
+            int left_idx = state->left_idx;
+            int mid = left_idx + state->width;
+            state->mid = mid;
+            state->right_idx = mid + state->width < state->len ? mid + state->width : state->len;
+            for (int i = left_idx; i < mid; i++) {
+                state->scratch[i] = state->arr[i];
+            }
+            state->counters.writes += mid - left_idx;
+            state->a_idx = left_idx;
+            state->b_idx = mid;
+            state->out_idx = left_idx;
+            return true;
+        }
+        // a lone run at the end of the pass is left for the next one
+        state->width *= 2;
+        state->left_idx = 0;
+    }
+    return false;
+}
+
+void SORT_FN(merge_sort_init)(struct SORT_STATE* state, SORT_TYPE* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->width = 1;
+    state->left_idx = 0;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+    state->scratch = malloc(len * sizeof(SORT_TYPE));
+    count_allocation(&state->counters, state->scratch, len * sizeof(SORT_TYPE));
+    // nothing can be merged without the scratch buffer
+    state->done = len > 1 && state->scratch == NULL;
+    if (!state->done) {
+        state->done = !SORT_FN(merge_begin)(state);
+    }
+}
+
+void SORT_FN(merge_sort_free)(struct SORT_STATE* state) {
+    count_free(&state->counters, state->scratch, state->len * sizeof(SORT_TYPE));
+    free(state->scratch);
+    state->scratch = NULL;
+}
+
+void SORT_FN(merge_sort_step)(struct SORT_STATE* state) {
+    if (state->done) {
+        return;
+    }
+    SORT_TYPE* arr = state->arr;
+    // ties are taken from the left run, which keeps the sort stable
+    if (state->b_idx < state->right_idx) {
+        state->counters.comparisons++;
+    }
+    if (state->b_idx >= state->right_idx || !SORT_LESS(arr[state->b_idx], state->scratch[state->a_idx])) {
+        arr[state->out_idx] = state->scratch[state->a_idx++];
+    } else {
+        arr[state->out_idx] = arr[state->b_idx++];
+    }
+    state->counters.writes++;
+    log_write(state->write_log, state->out_idx);
+    state->out_idx++;
+
+    if (state->a_idx == state->mid) {
+        state->left_idx += 2 * state->width;
+        state->done = !SORT_FN(merge_begin)(state);
+    }
+}
+
+long long SORT_FN(merge_sort_step_n)(struct SORT_STATE* state, long long n) {
+    long long i = 0;
+    while (i < n && !state->done) {
+        SORT_FN(merge_sort_step)(state);
+        i++;
+    }
+    return i;
+}
+
+// ================== One-shot ==================
+void SORT_FN(insertion_sort)(SORT_TYPE* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        SORT_TYPE value = arr[i];
+        int j = i;
+        while (j > 0 && SORT_LESS(value, arr[j - 1])) {
+            arr[j] = arr[j - 1];
+            j--;
+        }
+        arr[j] = value;
+    }
+}
+
+static inline void SORT_FN(swap)(SORT_TYPE* a, SORT_TYPE* b) {
+    SORT_TYPE temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static void SORT_FN(sift_down)(SORT_TYPE* heap, int node, int len) {
+    while (2 * node + 1 < len) {
+        int child = 2 * node + 1;
+        if (child + 1 < len && SORT_LESS(heap[child], heap[child + 1])) {
+            child++;
+        }
+        if (!SORT_LESS(heap[node], heap[child])) {
+            return;
+        }
+        SORT_FN(swap)(&heap[node], &heap[child]);
+        node = child;
+    }
+}
+
+static void SORT_FN(heap_sort)(SORT_TYPE* arr, int len) {
+    for (int node = len / 2 - 1; node >= 0; node--) {
+        SORT_FN(sift_down)(arr, node, len);
+    }
+    for (int end = len - 1; end > 0; end--) {
+        SORT_FN(swap)(&arr[0], &arr[end]);
+        SORT_FN(sift_down)(arr, 0, end);
+    }
+}
+
+static void SORT_FN(intro_sort)(SORT_TYPE* arr, int len, int depth) {
+    while (len > SORT_INSERTION_THRESHOLD) {
+        if (depth-- == 0) {
+            SORT_FN(heap_sort)(arr, len);
+            return;
+        }
+        // order the first, middle and last element, the median ends up at
+        // arr[mid] and the outer two stop the scans below
+        int mid = len / 2;
+        if (SORT_LESS(arr[mid], arr[0])) {
+            SORT_FN(swap)(&arr[mid], &arr[0]);
+        }
+        if (SORT_LESS(arr[len - 1], arr[mid])) {
+            SORT_FN(swap)(&arr[len - 1], &arr[mid]);
+            if (SORT_LESS(arr[mid], arr[0])) {
+                SORT_FN(swap)(&arr[mid], &arr[0]);
+            }
+        }
+        SORT_TYPE pivot = arr[mid];
+
+        // Hoare partition, elements equal to the pivot stop both scans so
+        // that runs of equal elements are split evenly
+        int i = 0;
+        int j = len - 1;
+        while (true) {
+            do {
+                i++;
+            } while (SORT_LESS(arr[i], pivot));
+            do {
+                j--;
+            } while (SORT_LESS(pivot, arr[j]));
+            if (i >= j) {
+                break;
+            }
+            SORT_FN(swap)(&arr[i], &arr[j]);
+        }
+
+        // recurse into the smaller side, loop on the larger one
+        int left_len = j + 1;
+        if (left_len < len - left_len) {
+            SORT_FN(intro_sort)(arr, left_len, depth);
+            arr += left_len;
+            len -= left_len;
+        } else {
+            SORT_FN(intro_sort)(arr + left_len, len - left_len, depth);
+            len = left_len;
+        }
+    }
+    SORT_FN(insertion_sort)(arr, len);
+}
+
+void SORT_FN(sort)(SORT_TYPE* arr, int len) {
+    int depth = 0;
+    for (int n = len; n > 1; n /= 2) {
+        depth += 2;
+    }
+    SORT_FN(intro_sort)(arr, len, depth);
+}
+
+#endif // SORT_IMPLEMENTATION
+
+#undef SORT_CAT_
+#undef SORT_CAT
+#undef SORT_FN
+#undef SORT_STATE
+#undef SORT_INSERTION_THRESHOLD
+#undef SORT_NAME
+#undef SORT_STRUCT
+#undef SORT_TYPE
+#undef SORT_LESS
+#undef SORT_IMPLEMENTATION
@@ -0,0 +1,2 @@
+#define SORT_TYPES_IMPLEMENTATION
+#include "sort_types.h"
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// The element types sort_generic.h is instantiated for, besides int which
+// has the hand-written algorithms. Each gets u32_sort(), u32_merge_sort_init()
+// and so on with the ordering below. sort_types.c defines
+// SORT_TYPES_IMPLEMENTATION to generate the definitions.
+
+// key with a payload that travels with it, sorted by key only
+struct Record16 {
+    uint64_t key;
+    uint64_t payload;
+};
+
+// NaNs are ordered after every number, and are equal to each other, so an
+// array with NaNs still has a well-defined sorted order
+#define FLOAT_LESS(a, b) ((a) < (b) || (!isnan(a) && isnan(b)))
+
+#define SORT_NAME u32
+#define SORT_STRUCT U32
+#define SORT_TYPE uint32_t
+#define SORT_LESS(a, b) ((a) < (b))
+#ifdef SORT_TYPES_IMPLEMENTATION
+#define SORT_IMPLEMENTATION
+#endif
+#include "sort_generic.h"
+
+#define SORT_NAME u64
+#define SORT_STRUCT U64
+#define SORT_TYPE uint64_t
+#define SORT_LESS(a, b) ((a) < (b))
+#ifdef SORT_TYPES_IMPLEMENTATION
+#define SORT_IMPLEMENTATION
+#endif
+#include "sort_generic.h"
+
+#define SORT_NAME f32
+#define SORT_STRUCT F32
+#define SORT_TYPE float
+#define SORT_LESS(a, b) FLOAT_LESS(a, b)
+#ifdef SORT_TYPES_IMPLEMENTATION
+#define SORT_IMPLEMENTATION
+#endif
+#include "sort_generic.h"
+
+#define SORT_NAME f64
+#define SORT_STRUCT F64
+#define SORT_TYPE double
+#define SORT_LESS(a, b) FLOAT_LESS(a, b)
+#ifdef SORT_TYPES_IMPLEMENTATION
+#define SORT_IMPLEMENTATION
+#endif
+#include "sort_generic.h"
+
+#define SORT_NAME record16
+#define SORT_STRUCT Record16
+#define SORT_TYPE struct Record16
+#define SORT_LESS(a, b) ((a).key < (b).key)
+#ifdef SORT_TYPES_IMPLEMENTATION
+#define SORT_IMPLEMENTATION
+#endif
+#include "sort_generic.h"
@@ -0,0 +1,470 @@
+#include "timsort.h"
+#include <string.h>
+
+// Ties put the left run's element first, which keeps the merge stable. In a
+// forward merge the copied run is the left one, in a backward merge it is
+// the right one.
+static inline bool takes_other(int dir, int other, int copied) {
+    return dir > 0 ? other < copied : other > copied;
+}
+
+// whether elem ends a run of wins of its run, against value from the other
+// run if value_is_other, otherwise against value from the copied run
+static inline bool gallop_stops(int dir, int elem, int value, bool value_is_other) {
+    return value_is_other ? takes_other(dir, value, elem) : !takes_other(dir, elem, value);
+}
+
+// Galloping search over the n sorted elements arr[start], arr[start + dir],
+// ... for the first one that gallop_stops. It probes 1, 2, 4, ... elements
+// away before a binary search, so k wins in a row take O(log k) comparisons.
+// Returns n if every element wins.
+static int gallop(struct Counters* counters, const int* arr, int start, int n, int dir, int value, bool value_is_other) {
+    long long known_win = -1; // last offset known to win
+    long long probe = 0;
+    long long step = 1;
+    while (probe < n) {
+        counters->comparisons++;
+        if (gallop_stops(dir, arr[start + probe * dir], value, value_is_other)) {
+            break;
+        }
+        known_win = probe;
+        probe += step;
+        step *= 2;
+    }
+    // the first element that stops is in (known_win, probe], probe itself
+    // is known to stop unless it is past the end
+    int lo = (int)known_win + 1;
+    int hi = probe < n ? (int)probe : n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        counters->comparisons++;
+        if (gallop_stops(dir, arr[start + mid * dir], value, value_is_other)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// min_run for len elements: len itself below TIM_SORT_MIN_MERGE, otherwise
+// the top bits of len plus one if any of the others are set, so that
+// len / min_run is a power of two or slightly below one and the merges stay
+// balanced
+static int compute_min_run(int len) {
+    int rest = 0;
+    while (len >= TIM_SORT_MIN_MERGE) {
+        rest |= len & 1;
+        len >>= 1;
+    }
+    return len + rest;
+}
+
+// ================== Runs ==================
+static void begin_merge(struct TimSortState* state, int merge_idx);
+
+static void begin_run(struct TimSortState* state, int start) {
+    state->phase = TIM_SORT_FIND_RUN;
+    state->run_start = start;
+    state->run_end = start + 1;
+    state->descending = false;
+}
+
+// index of the lower of the next two runs to merge, -1 if the stack keeps
+// the invariants len[i] > len[i + 1] + len[i + 2] and len[i] > len[i + 1].
+// Checking them on the top four runs, not just three, is what keeps them
+// for the whole stack. force merges until a single run is left.
+static int pick_merge(const struct TimSortState* state, bool force) {
+    const struct TimSortRun* runs = state->runs;
+    int n = state->num_runs;
+    if (n < 2) {
+        return -1;
+    }
+    if (force || (n >= 3 && runs[n - 3].len <= runs[n - 2].len + runs[n - 1].len) ||
+        (n >= 4 && runs[n - 4].len <= runs[n - 3].len + runs[n - 2].len)) {
+        // merge the middle run with the smaller of its neighbours
+        return n >= 3 && runs[n - 3].len < runs[n - 1].len ? n - 3 : n - 2;
+    }
+    if (runs[n - 2].len <= runs[n - 1].len) {
+        return n - 2;
+    }
+    return -1;
+}
+
+// merge while the stack breaks the invariants, then find the next run, at
+// the end of the array merge everything that is left
+static void next_action(struct TimSortState* state) {
+    int n = state->num_runs;
+    int next = n > 0 ? state->runs[n - 1].start + state->runs[n - 1].len : 0;
+    bool at_end = next == state->len;
+    int merge_idx = pick_merge(state, at_end);
+    if (merge_idx >= 0) {
+        begin_merge(state, merge_idx);
+    } else if (!at_end) {
+        begin_run(state, next);
+    } else {
+        state->done = true;
+    }
+}
+
+// extend the current run to min_run elements by binary insertion, or push
+// it once it is long enough or reaches the end of the array
+static void begin_extend(struct TimSortState* state) {
+    int end = state->len - state->run_start > state->min_run ? state->run_start + state->min_run : state->len;
+    if (state->run_end < end) {
+        state->phase = TIM_SORT_EXTEND;
+        state->lo = state->run_start;
+        state->hi = state->run_end;
+        state->value = state->arr[state->run_end];
+        return;
+    }
+    state->runs[state->num_runs++] = (struct TimSortRun){state->run_start, state->run_end - state->run_start};
+    next_action(state);
+}
+
+static void find_run_step(struct TimSortState* state) {
+    int* arr = state->arr;
+    if (state->run_end < state->len) {
+        int value = arr[state->run_end];
+        int prev = arr[state->run_end - 1];
+        state->counters.comparisons++;
+        // the second element decides the direction, descending runs have to
+        // be strictly descending so that reversing them keeps the sort stable
+        bool extends = true;
+        if (state->run_end == state->run_start + 1) {
+            state->descending = value < prev;
+        } else {
+            extends = state->descending ? value < prev : value >= prev;
+        }
+        if (extends) {
+            state->run_end++;
+            if (state->run_end < state->len) {
+                return;
+            }
+        }
+    }
+
+    if (state->descending) {
+        state->phase = TIM_SORT_REVERSE;
+        state->reverse_lo = state->run_start;
+        state->reverse_hi = state->run_end - 1;
+    } else {
+        begin_extend(state);
+    }
+}
+
+static void reverse_step(struct TimSortState* state) {
+    int* arr = state->arr;
+    int lo = state->reverse_lo;
+    int hi = state->reverse_hi;
+    int temp = arr[lo];
+    arr[lo] = arr[hi];
+    arr[hi] = temp;
+    state->counters.swaps++;
+    state->counters.writes += 2;
+    log_write(state->write_log, lo);
+    log_write(state->write_log, hi);
+    state->reverse_lo++;
+    state->reverse_hi--;
+    if (state->reverse_lo >= state->reverse_hi) {
+        state->descending = false;
+        begin_extend(state);
+    }
+}
+
+// same as binary_insert_sort_step on arr[run_start, run_end]
+static void extend_step(struct TimSortState* state) {
+    int* arr = state->arr;
+    if (state->lo < state->hi) {
+        int mid = state->lo + (state->hi - state->lo) / 2;
+        state->counters.comparisons++;
+        if (arr[mid] > state->value) {
+            state->hi = mid;
+        } else {
+            state->lo = mid + 1;
+        }
+        return;
+    }
+
+    int slot = state->lo;
+    memmove(arr + slot + 1, arr + slot, (state->run_end - slot) * sizeof(int));
+    arr[slot] = state->value;
+    state->counters.writes += state->run_end - slot + 1;
+    for (int k = slot; k <= state->run_end; k++) {
+        log_write(state->write_log, k);
+    }
+    state->run_end++;
+    begin_extend(state);
+}
+
+// ================== Merges ==================
+static void log_block(struct TimSortState* state, int start, int k) {
+    state->counters.writes += k;
+    for (int i = start; i < start + k; i++) {
+        log_write(state->write_log, i);
+    }
+}
+
+// move the next k elements of the copied run to the output
+static void emit_copied(struct TimSortState* state, int k) {
+    if (k == 0) {
+        return;
+    }
+    int from = state->dir > 0 ? state->copied_idx : state->copied_idx - k + 1;
+    int to = state->dir > 0 ? state->out_idx : state->out_idx - k + 1;
+    memcpy(state->arr + to, state->scratch + from, k * sizeof(int));
+    log_block(state, to, k);
+    state->copied_idx += k * state->dir;
+    state->copied_left -= k;
+    state->out_idx += k * state->dir;
+}
+
+// move the next k elements of the other run to the output, which trails
+// them in the same array
+static void emit_other(struct TimSortState* state, int k) {
+    if (k == 0) {
+        return;
+    }
+    int from = state->dir > 0 ? state->other_idx : state->other_idx - k + 1;
+    int to = state->dir > 0 ? state->out_idx : state->out_idx - k + 1;
+    memmove(state->arr + to, state->arr + from, k * sizeof(int));
+    log_block(state, to, k);
+    state->other_idx += k * state->dir;
+    state->other_left -= k;
+    state->out_idx += k * state->dir;
+}
+
+static void begin_merge(struct TimSortState* state, int merge_idx) {
+    state->phase = TIM_SORT_TRIM_LEFT;
+    state->merge_idx = merge_idx;
+    state->jump_from = -1;
+    state->jump_to = -1;
+}
+
+// replace the two merged runs by one and carry on
+static void finish_merge(struct TimSortState* state) {
+    struct TimSortRun* runs = state->runs;
+    int i = state->merge_idx;
+    runs[i].len += runs[i + 1].len;
+    if (i + 2 < state->num_runs) {
+        runs[i + 1] = runs[i + 2];
+    }
+    state->num_runs--;
+    next_action(state);
+}
+
+// one of the runs is used up, the rest of the copied run goes to the output
+// and the rest of the other one is already in place
+static void end_merge(struct TimSortState* state) {
+    emit_copied(state, state->copied_left);
+    finish_merge(state);
+}
+
+// the elements at the start of the left run that are not greater than the
+// first element of the right run are already in place
+static void trim_left_step(struct TimSortState* state) {
+    struct TimSortRun left = state->runs[state->merge_idx];
+    struct TimSortRun right = state->runs[state->merge_idx + 1];
+    int k = gallop(&state->counters, state->arr, left.start, left.len, 1, state->arr[right.start], true);
+    state->jump_from = left.start;
+    state->jump_to = left.start + k;
+    if (k == left.len) {
+        finish_merge(state);
+        return;
+    }
+    // out_idx holds the first element of the left run that has to move
+    state->out_idx = left.start + k;
+    state->phase = TIM_SORT_TRIM_RIGHT;
+}
+
+// the same for the elements at the end of the right run that are not less
+// than the last element of the left run, the smaller of the two rests is
+// then copied to scratch
+static void trim_right_step(struct TimSortState* state) {
+    struct TimSortRun right = state->runs[state->merge_idx + 1];
+    int* arr = state->arr;
+    int left_start = state->out_idx;
+    int left_len = right.start - left_start;
+    int right_end = right.start + right.len - 1;
+    int k = gallop(&state->counters, arr, right_end, right.len, -1, arr[right.start - 1], true);
+    state->jump_from = right_end;
+    state->jump_to = right_end - k;
+    int right_len = right.len - k;
+    if (right_len == 0) {
+        finish_merge(state);
+        return;
+    }
+
+    if (state->scratch == NULL) {
+        // the smaller rest of a merge is at most half the array
+        state->scratch = malloc(state->len / 2 * sizeof(int));
+        count_allocation(&state->counters, state->scratch, state->len / 2 * sizeof(int));
+        if (state->scratch == NULL) {
+            state->done = true;
+            return;
+        }
+    }
+    if (left_len <= right_len) {
+        memcpy(state->scratch, arr + left_start, left_len * sizeof(int));
+        state->counters.writes += left_len;
+        state->dir = 1;
+        state->copied_idx = 0;
+        state->copied_left = left_len;
+        state->other_idx = right.start;
+        state->other_left = right_len;
+        state->out_idx = left_start;
+    } else {
+        memcpy(state->scratch, arr + right.start, right_len * sizeof(int));
+        state->counters.writes += right_len;
+        state->dir = -1;
+        state->copied_idx = right_len - 1;
+        state->copied_left = right_len;
+        state->other_idx = right.start - 1;
+        state->other_left = left_len;
+        state->out_idx = right.start + right_len - 1;
+    }
+    state->wins = 0;
+    state->other_won = false;
+    state->phase = TIM_SORT_MERGE;
+}
+
+static void merge_step(struct TimSortState* state) {
+    int other = state->arr[state->other_idx];
+    int copied = state->scratch[state->copied_idx];
+    state->counters.comparisons++;
+    bool other_wins = takes_other(state->dir, other, copied);
+    if (other_wins) {
+        emit_other(state, 1);
+    } else {
+        emit_copied(state, 1);
+    }
+    state->wins = other_wins == state->other_won ? state->wins + 1 : 1;
+    state->other_won = other_wins;
+
+    if (state->copied_left == 0 || state->other_left == 0) {
+        end_merge(state);
+    } else if (state->wins >= state->min_gallop) {
+        state->phase = TIM_SORT_GALLOP_COPIED;
+    }
+}
+
+// move the copied elements that win against the next element of the other
+// run as a block, followed by that element
+static void gallop_copied_step(struct TimSortState* state) {
+    int k = gallop(&state->counters, state->scratch, state->copied_idx, state->copied_left, state->dir,
+                   state->arr[state->other_idx], true);
+    state->jump_from = state->out_idx;
+    emit_copied(state, k);
+    state->jump_to = state->out_idx;
+    state->copied_jump = k;
+    if (state->copied_left == 0) {
+        end_merge(state);
+        return;
+    }
+    emit_other(state, 1);
+    if (state->other_left == 0) {
+        end_merge(state);
+        return;
+    }
+    state->phase = TIM_SORT_GALLOP_OTHER;
+}
+
+// the same for the other run, galloping goes on while either run moves at
+// least TIM_SORT_MIN_GALLOP elements at once, which also makes it start
+// sooner next time, and is made harder to start again once it stops paying
+static void gallop_other_step(struct TimSortState* state) {
+    int k = gallop(&state->counters, state->arr, state->other_idx, state->other_left, state->dir,
+                   state->scratch[state->copied_idx], false);
+    state->jump_from = state->out_idx;
+    emit_other(state, k);
+    state->jump_to = state->out_idx;
+    if (state->other_left == 0) {
+        end_merge(state);
+        return;
+    }
+    emit_copied(state, 1);
+    if (state->copied_left == 0) {
+        end_merge(state);
+        return;
+    }
+
+    if (state->copied_jump < TIM_SORT_MIN_GALLOP && k < TIM_SORT_MIN_GALLOP) {
+        state->min_gallop++;
+        state->wins = 0;
+        state->phase = TIM_SORT_MERGE;
+    } else {
+        state->min_gallop -= state->min_gallop > 1;
+        state->phase = TIM_SORT_GALLOP_COPIED;
+    }
+}
+
+// ================== Stepwise ==================
+void tim_sort_init(struct TimSortState* state, int* arr, int len) {
+    state->arr = arr;
+    state->len = len;
+    state->min_run = compute_min_run(len);
+    state->num_runs = 0;
+    state->scratch = NULL;
+    state->dir = 1;
+    state->copied_idx = 0;
+    state->copied_left = 0;
+    state->other_idx = 0;
+    state->other_left = 0;
+    state->out_idx = 0;
+    state->wins = 0;
+    state->other_won = false;
+    state->min_gallop = TIM_SORT_MIN_GALLOP;
+    state->copied_jump = 0;
+    state->jump_from = -1;
+    state->jump_to = -1;
+    state->done = false;
+    state->counters = (struct Counters){0};
+    state->write_log = NULL;
+    next_action(state);
+}
+
+void tim_sort_step(struct TimSortState* state) {
+    if (state->done) {
+        return;
+    }
+    switch (state->phase) {
+    case TIM_SORT_FIND_RUN:
+        find_run_step(state);
+        break;
+    case TIM_SORT_REVERSE:
+        reverse_step(state);
+        break;
+    case TIM_SORT_EXTEND:
+        extend_step(state);
+        break;
+    case TIM_SORT_TRIM_LEFT:
+        trim_left_step(state);
+        break;
+    case TIM_SORT_TRIM_RIGHT:
+        trim_right_step(state);
+        break;
+    case TIM_SORT_MERGE:
+        merge_step(state);
+        break;
+    case TIM_SORT_GALLOP_COPIED:
+        gallop_copied_step(state);
+        break;
+    case TIM_SORT_GALLOP_OTHER:
+        gallop_other_step(state);
+        break;
+    }
+}
+
+long long tim_sort_step_n(struct TimSortState* state, long long n) {
+    long long i = 0;
+    for (; i < n && !state->done; i++) {
+        tim_sort_step(state);
+    }
+    return i;
+}
+
+void tim_sort_free(struct TimSortState* state) {
+    count_free(&state->counters, state->scratch, state->len / 2 * sizeof(int));
+    free(state->scratch);
+    state->scratch = NULL;
+}
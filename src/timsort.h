@@ -0,0 +1,91 @@
+#pragma once
+
+#include "algorithms.h"
+#include <stdbool.h>
+
+// Natural merge sort in the style of Timsort. The array is scanned for runs
+// that are already ascending or strictly descending (reversed in place),
+// short runs are extended to min_run elements with binary insertion and the
+// runs are merged from a stack whose lengths are kept growing at least like
+// the Fibonacci numbers, so every element takes part in O(log n) merges.
+// Presorted input becomes a few long runs, sorted input a single one, which
+// takes n - 1 comparisons and no writes.
+//
+// A merge first gallops over the elements of both runs that are already in
+// place and copies only the smaller rest to scratch. It then takes one
+// element per step until one run wins TIM_SORT_MIN_GALLOP times in a row and
+// switches to galloping, where a step finds how many elements in a row
+// a run wins with an exponential search and moves them as a block.
+
+// arrays shorter than this are a single run extended by binary insertion,
+// otherwise min_run is between TIM_SORT_MIN_MERGE / 2 and TIM_SORT_MIN_MERGE
+#define TIM_SORT_MIN_MERGE 64
+// initial number of wins in a row that start galloping, it adapts to the input
+#define TIM_SORT_MIN_GALLOP 7
+// the invariants keep the stack below log_phi(2^31) runs
+#define TIM_SORT_MAX_RUNS 64
+
+enum TimSortPhase {
+    TIM_SORT_FIND_RUN,      // extend the run at run_start, one comparison per step
+    TIM_SORT_REVERSE,       // reverse a strictly descending run, one swap per step
+    TIM_SORT_EXTEND,        // binary insertion of the elements up to min_run
+    TIM_SORT_TRIM_LEFT,     // gallop over the left run's elements already in place
+    TIM_SORT_TRIM_RIGHT,    // same for the right run, then copy the smaller rest
+    TIM_SORT_MERGE,         // one element per step
+    TIM_SORT_GALLOP_COPIED, // gallop in the run copied to scratch
+    TIM_SORT_GALLOP_OTHER,  // gallop in the run left in arr
+};
+
+struct TimSortRun {
+    int start;
+    int len;
+};
+
+struct TimSortState {
+    int* arr;
+    int len;
+    int min_run;
+    // sorted runs waiting to be merged, from left to right
+    struct TimSortRun runs[TIM_SORT_MAX_RUNS];
+    int num_runs;
+    enum TimSortPhase phase;
+    // run being found and extended, arr[run_start, run_end) is sorted
+    // unless descending is set
+    int run_start;
+    int run_end;
+    bool descending;
+    // reversal swaps reverse_lo and reverse_hi, binary insertion of
+    // arr[run_end] searches its slot in [lo, hi]
+    int reverse_lo;
+    int reverse_hi;
+    int lo;
+    int hi;
+    int value;
+    // merge of runs[merge_idx] and runs[merge_idx + 1], the smaller rest is
+    // in scratch and is merged with the other one towards the far end of the
+    // larger run, forwards (dir 1) if that is the left run and backwards
+    // (dir -1) otherwise
+    int merge_idx;
+    int* scratch; // len / 2 ints, allocated by the first merge
+    int dir;
+    int copied_idx; // next element of the copied run, in scratch
+    int copied_left;
+    int other_idx; // next element of the other run, in arr
+    int other_left;
+    int out_idx;     // next position written
+    int wins;        // of the run that won the last comparison, in a row
+    bool other_won;  // the other run won the last comparison
+    int min_gallop;  // wins in a row that start galloping
+    int copied_jump; // elements the last gallop in the copied run moved
+    // positions the last gallop skipped or moved a block over, -1 if none
+    int jump_from;
+    int jump_to;
+    bool done;
+    struct Counters counters;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+void tim_sort_init(struct TimSortState* state, int* arr, int len);
+void tim_sort_step(struct TimSortState* state);
+long long tim_sort_step_n(struct TimSortState* state, long long n);
+void tim_sort_free(struct TimSortState* state);
@@ -0,0 +1,618 @@
+#include "trace.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRACE_MAGIC "AVTR"
+#define TRACE_MAGIC_LEN 4
+#define TRACE_FOOTER_LEN 8
+// of the first varint of a record, traces before version 3 have 2 and no
+// COMPARE records
+#define TRACE_TAG_BITS 3
+// indices a single step may write before trace_record compares the whole
+// array instead, only block moves come close to it
+#define TRACE_STEP_LOG_CAPACITY (1 << 16)
+
+enum TraceTag {
+    TRACE_STEP,
+    TRACE_WRITE,
+    TRACE_HIGHLIGHTS,
+    TRACE_END,
+    TRACE_COMPARE,
+};
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// ================== Writer ==================
+static void record_highlights(struct TraceWriter* writer,
+                              const struct Highlight* highlights,
+                              int num_highlights,
+                              bool* changed);
+
+static void flush(struct TraceWriter* writer) {
+    if (writer->buffer_len > 0 &&
+        fwrite(writer->buffer, 1, writer->buffer_len, writer->file) != (size_t)writer->buffer_len) {
+        writer->error = true;
+    }
+    writer->buffer_len = 0;
+}
+
+static void put_byte(struct TraceWriter* writer, uint8_t byte) {
+    if (writer->buffer_len == (int)sizeof(writer->buffer)) {
+        flush(writer);
+    }
+    writer->buffer[writer->buffer_len++] = byte;
+}
+
+// encode v into out, which must have room for TRACE_MAX_VARINT bytes,
+// returns the number of bytes
+static int encode_varint(uint8_t* out, uint64_t v) {
+    int len = 0;
+    while (v >= 0x80) {
+        out[len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[len++] = (uint8_t)v;
+    return len;
+}
+
+static void put_varint(struct TraceWriter* writer, uint64_t v) {
+    uint8_t bytes[TRACE_MAX_VARINT];
+    int len = encode_varint(bytes, v);
+    for (int i = 0; i < len; i++) {
+        put_byte(writer, bytes[i]);
+    }
+}
+
+static void put_record(struct TraceWriter* writer, enum TraceTag tag, uint64_t payload) {
+    put_varint(writer, payload << TRACE_TAG_BITS | tag);
+}
+
+bool trace_writer_open(struct TraceWriter* writer,
+                       const char* path,
+                       enum AlgorithmType algorithm,
+                       const int* arr,
+                       int len,
+                       const struct Highlight* highlights,
+                       int num_highlights) {
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        return false;
+    }
+    writer->shadow = malloc((len > 0 ? len : 1) * sizeof(int));
+    if (writer->shadow == NULL) {
+        fclose(writer->file);
+        return false;
+    }
+    memcpy(writer->shadow, arr, len * sizeof(int));
+    writer->buffer_len = 0;
+    writer->len = len;
+    writer->last_write_idx = 0;
+    writer->num_highlights = 0;
+    writer->last_highlights_len = 0;
+    writer->steps = 0;
+    writer->pending_steps = 0;
+    writer->error = false;
+
+    for (int i = 0; i < TRACE_MAGIC_LEN; i++) {
+        put_byte(writer, TRACE_MAGIC[i]);
+    }
+    put_byte(writer, TRACE_VERSION);
+    put_varint(writer, algorithm);
+    put_varint(writer, len);
+    int prev = 0;
+    for (int i = 0; i < len; i++) {
+        put_varint(writer, zigzag((int64_t)arr[i] - prev));
+        prev = arr[i];
+    }
+    bool changed = false;
+    record_highlights(writer, highlights, num_highlights, &changed);
+    // the changes of a step come before its STEP record
+    put_record(writer, TRACE_STEP, 0);
+    return true;
+}
+
+// the first change of a step closes the STEP record of the steps before it
+static void begin_changes(struct TraceWriter* writer, bool* changed) {
+    if (*changed) {
+        return;
+    }
+    if (writer->pending_steps > 0) {
+        put_record(writer, TRACE_STEP, writer->pending_steps);
+        writer->pending_steps = 0;
+    }
+    *changed = true;
+}
+
+static void record_write(struct TraceWriter* writer, const int* arr, int idx, bool* changed) {
+    if (arr[idx] == writer->shadow[idx]) {
+        return;
+    }
+    begin_changes(writer, changed);
+    put_record(writer, TRACE_WRITE, zigzag((int64_t)idx - writer->last_write_idx));
+    put_varint(writer, zigzag((int64_t)arr[idx] - writer->shadow[idx]));
+    writer->shadow[idx] = arr[idx];
+    writer->last_write_idx = idx;
+}
+
+static void record_highlights(struct TraceWriter* writer,
+                              const struct Highlight* highlights,
+                              int num_highlights,
+                              bool* changed) {
+    // two bits per highlight, bit 2k if its index changed and bit 2k + 1
+    // if its role or worker changed, new highlights have both set
+    uint64_t mask = 0;
+    for (int k = 0; k < num_highlights; k++) {
+        const struct Highlight* prev = &writer->highlights[k];
+        bool is_new = k >= writer->num_highlights;
+        if (is_new || highlights[k].idx != prev->idx) {
+            mask |= 1ull << (2 * k);
+        }
+        if (is_new || highlights[k].role != prev->role || highlights[k].worker != prev->worker) {
+            mask |= 1ull << (2 * k + 1);
+        }
+    }
+    if (mask == 0 && num_highlights == writer->num_highlights) {
+        return;
+    }
+
+    // the record is built first, a sweep moves its highlights by the same
+    // amount every step and then only a repeat is written
+    uint8_t record[TRACE_MAX_HIGHLIGHTS_RECORD];
+    int record_len = encode_varint(record, (uint64_t)num_highlights << TRACE_TAG_BITS | TRACE_HIGHLIGHTS);
+    record_len += encode_varint(record + record_len, mask);
+    for (int k = 0; k < num_highlights; k++) {
+        int prev_idx = k < writer->num_highlights ? writer->highlights[k].idx : 0;
+        if (mask & (1ull << (2 * k))) {
+            record_len +=
+                encode_varint(record + record_len, zigzag((int64_t)highlights[k].idx - prev_idx));
+        }
+        if (mask & (1ull << (2 * k + 1))) {
+            record_len += encode_varint(record + record_len,
+                                        (uint64_t)highlights[k].role |
+                                            (uint64_t)highlights[k].worker << 2);
+        }
+        writer->highlights[k] = highlights[k];
+    }
+
+    begin_changes(writer, changed);
+    if (record_len == writer->last_highlights_len &&
+        memcmp(record, writer->last_highlights, record_len) == 0) {
+        put_record(writer, TRACE_HIGHLIGHTS, TRACE_HIGHLIGHTS_REPEAT);
+    } else {
+        for (int i = 0; i < record_len; i++) {
+            put_byte(writer, record[i]);
+        }
+        memcpy(writer->last_highlights, record, record_len);
+        writer->last_highlights_len = record_len;
+    }
+    writer->num_highlights = num_highlights;
+}
+
+void trace_writer_step(struct TraceWriter* writer,
+                       const int* arr,
+                       const struct WriteLog* log,
+                       const struct Highlight* highlights,
+                       int num_highlights,
+                       long long comparisons) {
+    bool changed = false;
+    if (log == NULL || log->overflow) {
+        for (int i = 0; i < writer->len; i++) {
+            record_write(writer, arr, i, &changed);
+        }
+    } else {
+        for (int k = 0; k < log->len; k++) {
+            record_write(writer, arr, log->indices[k], &changed);
+        }
+    }
+    record_highlights(writer, highlights, num_highlights, &changed);
+    if (comparisons > 0) {
+        begin_changes(writer, &changed);
+        put_record(writer, TRACE_COMPARE, (uint64_t)comparisons);
+    }
+    writer->steps++;
+    writer->pending_steps++;
+}
+
+bool trace_writer_close(struct TraceWriter* writer) {
+    if (writer->pending_steps > 0) {
+        put_record(writer, TRACE_STEP, writer->pending_steps);
+    }
+    put_record(writer, TRACE_END, 0);
+    for (int i = 0; i < TRACE_FOOTER_LEN; i++) {
+        put_byte(writer, (uint8_t)((uint64_t)writer->steps >> (8 * i)));
+    }
+    flush(writer);
+    if (fclose(writer->file) != 0) {
+        writer->error = true;
+    }
+    free(writer->shadow);
+    writer->shadow = NULL;
+    return !writer->error;
+}
+
+bool trace_record(struct Engine* engine, const int* arr, int len, const char* path) {
+    struct TraceWriter* writer = malloc(sizeof(struct TraceWriter));
+    struct WriteLog log;
+    if (writer == NULL || !write_log_init(&log, TRACE_STEP_LOG_CAPACITY)) {
+        free(writer);
+        return false;
+    }
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int num_highlights = engine_highlights(engine, highlights);
+    if (!trace_writer_open(writer, path, engine->algorithm_type, arr, len, highlights, num_highlights)) {
+        write_log_free(&log);
+        free(writer);
+        return false;
+    }
+
+    engine_set_write_log(engine, &log);
+    long long comparisons = engine_counters(engine).comparisons;
+    while (!engine_done(engine)) {
+        write_log_clear(&log);
+        engine_step_n(engine, 1);
+        int n = engine_highlights(engine, highlights);
+        long long total = engine_counters(engine).comparisons;
+        trace_writer_step(writer, arr, &log, highlights, n, total - comparisons);
+        comparisons = total;
+    }
+    engine_set_write_log(engine, NULL);
+
+    bool ok = trace_writer_close(writer);
+    write_log_free(&log);
+    free(writer);
+    return ok;
+}
+
+// ================== Player ==================
+static size_t body_end(const struct TracePlayer* player) {
+    return player->size - TRACE_FOOTER_LEN;
+}
+
+static bool read_varint(const struct TracePlayer* player, size_t* pos, uint64_t* out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= body_end(player)) {
+            return false;
+        }
+        uint8_t byte = player->data[(*pos)++];
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// decode the highlights record at the cursor, including its first varint
+static bool apply_highlights(struct TracePlayer* player) {
+    struct TraceCursor* cursor = &player->cursor;
+    uint64_t word;
+    uint64_t mask;
+    if (!read_varint(player, &cursor->pos, &word) || (word >> player->tag_bits) > MAX_HIGHLIGHTS ||
+        !read_varint(player, &cursor->pos, &mask)) {
+        return false;
+    }
+    int num_highlights = (int)(word >> player->tag_bits);
+    for (int k = 0; k < num_highlights; k++) {
+        struct Highlight* highlight = &player->highlights[k];
+        if (k >= player->num_highlights) {
+            *highlight = (struct Highlight){0, HIGHLIGHT_PRIMARY, 0};
+        }
+        uint64_t v;
+        if (mask & (1ull << (2 * k))) {
+            if (!read_varint(player, &cursor->pos, &v)) {
+                return false;
+            }
+            highlight->idx = (int)(highlight->idx + unzigzag(v));
+        }
+        if (mask & (1ull << (2 * k + 1))) {
+            if (!read_varint(player, &cursor->pos, &v)) {
+                return false;
+            }
+            highlight->role = (enum HighlightRole)(v & 3);
+            highlight->worker = (int)(v >> 2);
+        }
+    }
+    player->num_highlights = num_highlights;
+    return true;
+}
+
+// apply the next record, returns false at the end of the trace or on a
+// malformed record
+static bool apply_record(struct TracePlayer* player) {
+    struct TraceCursor* cursor = &player->cursor;
+    size_t start = cursor->pos;
+    uint64_t word;
+    if (!read_varint(player, &cursor->pos, &word)) {
+        return false;
+    }
+    uint64_t payload = word >> player->tag_bits;
+    switch (word & ((1u << player->tag_bits) - 1)) {
+    case TRACE_STEP:
+        cursor->pending_steps = (long long)payload;
+        return true;
+    case TRACE_WRITE: {
+        int64_t idx = cursor->last_write_idx + unzigzag(payload);
+        uint64_t delta;
+        if (!read_varint(player, &cursor->pos, &delta) || idx < 0 || idx >= player->len) {
+            return false;
+        }
+        player->values[idx] = (int)((int64_t)player->values[idx] + unzigzag(delta));
+        cursor->last_write_idx = (int)idx;
+        log_write(player->write_log, (int)idx);
+        return true;
+    }
+    case TRACE_HIGHLIGHTS: {
+        if (payload == TRACE_HIGHLIGHTS_REPEAT) {
+            // decode the last full record once more, the header comes
+            // before it so 0 means there is none
+            size_t next = cursor->pos;
+            cursor->pos = cursor->last_highlights_pos;
+            bool ok = cursor->pos != 0 && apply_highlights(player);
+            cursor->pos = next;
+            return ok;
+        }
+        cursor->pos = start;
+        cursor->last_highlights_pos = start;
+        return apply_highlights(player);
+    }
+    case TRACE_COMPARE:
+        cursor->comparisons += (long long)payload;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// decode forward until the state after step target, stops early at the end
+// of the trace
+static void advance_to(struct TracePlayer* player, long long target) {
+    struct TraceCursor* cursor = &player->cursor;
+    while (cursor->step < target) {
+        if (cursor->pending_steps > 0) {
+            long long take = target - cursor->step;
+            take = take < cursor->pending_steps ? take : cursor->pending_steps;
+            cursor->step += take;
+            cursor->pending_steps -= take;
+        } else if (!apply_record(player)) {
+            return;
+        }
+    }
+}
+
+// apply the records of step 0, up to and including the STEP record of 0
+// steps that ends them
+static void apply_step_zero(struct TracePlayer* player) {
+    uint64_t word;
+    do {
+        size_t pos = player->cursor.pos;
+        if (!read_varint(player, &pos, &word)) {
+            return;
+        }
+    } while (apply_record(player) && (word & ((1u << player->tag_bits) - 1)) != TRACE_STEP);
+}
+
+static bool save_keyframe(struct TracePlayer* player) {
+    struct TraceKeyframe* keyframe = &player->keyframes[player->num_keyframes];
+    keyframe->values = malloc((player->len > 0 ? player->len : 1) * sizeof(int));
+    if (keyframe->values == NULL) {
+        return false;
+    }
+    memcpy(keyframe->values, player->values, player->len * sizeof(int));
+    memcpy(keyframe->highlights, player->highlights, sizeof(player->highlights));
+    keyframe->num_highlights = player->num_highlights;
+    keyframe->cursor = player->cursor;
+    player->num_keyframes++;
+    return true;
+}
+
+static void restore_keyframe(struct TracePlayer* player, int k) {
+    const struct TraceKeyframe* keyframe = &player->keyframes[k];
+    memcpy(player->values, keyframe->values, player->len * sizeof(int));
+    memcpy(player->highlights, keyframe->highlights, sizeof(player->highlights));
+    player->num_highlights = keyframe->num_highlights;
+    player->cursor = keyframe->cursor;
+    if (player->write_log != NULL) {
+        // any element may have changed, the consumers redraw everything
+        player->write_log->overflow = true;
+    }
+}
+
+static bool load_file(struct TracePlayer* player, const char* path, bool use_mmap) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < TRACE_MAGIC_LEN + 1 + TRACE_FOOTER_LEN) {
+        close(fd);
+        return false;
+    }
+    player->size = (size_t)st.st_size;
+
+    if (use_mmap) {
+        void* data = mmap(NULL, player->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            player->data = data;
+            player->mapped = true;
+            close(fd);
+            return true;
+        }
+        // fall back to reading the file
+    }
+
+    uint8_t* data = malloc(player->size);
+    size_t got = 0;
+    while (data != NULL && got < player->size) {
+        ssize_t n = read(fd, data + got, player->size - got);
+        if (n <= 0) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        got += (size_t)n;
+    }
+    close(fd);
+    player->data = data;
+    player->mapped = false;
+    return data != NULL;
+}
+
+static bool parse_header(struct TracePlayer* player) {
+    const uint8_t* data = player->data;
+    if (memcmp(data, TRACE_MAGIC, TRACE_MAGIC_LEN) != 0 || data[TRACE_MAGIC_LEN] < 1 ||
+        data[TRACE_MAGIC_LEN] > TRACE_VERSION) {
+        return false;
+    }
+    player->version = data[TRACE_MAGIC_LEN];
+    player->tag_bits = player->version >= 3 ? TRACE_TAG_BITS : 2;
+    size_t pos = TRACE_MAGIC_LEN + 1;
+    uint64_t algorithm;
+    uint64_t len;
+    if (!read_varint(player, &pos, &algorithm) || !read_varint(player, &pos, &len) ||
+        algorithm >= NUM_ALGORITHM_TYPES || len > INT_MAX) {
+        return false;
+    }
+    player->algorithm = (enum AlgorithmType)algorithm;
+    player->len = (int)len;
+    player->values = malloc((len > 0 ? len : 1) * sizeof(int));
+    if (player->values == NULL) {
+        return false;
+    }
+    int prev = 0;
+    for (int i = 0; i < player->len; i++) {
+        uint64_t v;
+        if (!read_varint(player, &pos, &v)) {
+            return false;
+        }
+        prev = (int)((int64_t)prev + unzigzag(v));
+        player->values[i] = prev;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < TRACE_FOOTER_LEN; i++) {
+        total |= (uint64_t)data[body_end(player) + i] << (8 * i);
+    }
+    player->total_steps = (long long)total;
+    player->cursor = (struct TraceCursor){pos, 0, 0, 0, 0, 0};
+    return true;
+}
+
+// decode the whole trace once and keep a snapshot every keyframe_interval
+// steps, as many as TRACE_KEYFRAME_MEMORY allows
+static bool build_keyframes(struct TracePlayer* player) {
+    long long bytes = (long long)(player->len > 0 ? player->len : 1) * sizeof(int);
+    long long max_keyframes = TRACE_KEYFRAME_MEMORY / bytes;
+    max_keyframes = max_keyframes < 1 ? 1 : max_keyframes;
+    max_keyframes = max_keyframes > TRACE_MAX_KEYFRAMES ? TRACE_MAX_KEYFRAMES : max_keyframes;
+    player->keyframe_interval = (player->total_steps + max_keyframes - 1) / max_keyframes;
+    if (player->keyframe_interval < 1) {
+        player->keyframe_interval = 1;
+    }
+
+    // the step 0 keyframe plus one per interval
+    player->keyframes = calloc(max_keyframes + 1, sizeof(struct TraceKeyframe));
+    if (player->keyframes == NULL) {
+        return false;
+    }
+    if (player->version >= 2) {
+        apply_step_zero(player);
+    }
+    if (!save_keyframe(player)) {
+        return false;
+    }
+    while (player->cursor.step < player->total_steps) {
+        long long target = player->num_keyframes * player->keyframe_interval;
+        advance_to(player, target);
+        if (player->cursor.step < target) {
+            break;
+        }
+        if (player->num_keyframes <= max_keyframes && !save_keyframe(player)) {
+            return false;
+        }
+    }
+    // a truncated trace ends where its records end
+    player->total_steps = player->cursor.step;
+    restore_keyframe(player, 0);
+    return true;
+}
+
+bool trace_player_open(struct TracePlayer* player, const char* path, bool use_mmap) {
+    memset(player, 0, sizeof(*player));
+    if (!load_file(player, path, use_mmap)) {
+        fprintf(stderr, "could not read trace: %s\n", path);
+        return false;
+    }
+    if (!parse_header(player)) {
+        fprintf(stderr, "not a valid trace: %s\n", path);
+        trace_player_close(player);
+        return false;
+    }
+    if (!build_keyframes(player)) {
+        fprintf(stderr, "could not allocate the keyframes of %s\n", path);
+        trace_player_close(player);
+        return false;
+    }
+    return true;
+}
+
+void trace_player_close(struct TracePlayer* player) {
+    if (player->keyframes != NULL) {
+        for (int k = 0; k < player->num_keyframes; k++) {
+            free(player->keyframes[k].values);
+        }
+        free(player->keyframes);
+    }
+    if (player->mapped) {
+        munmap((void*)player->data, player->size);
+    } else {
+        free((void*)player->data);
+    }
+    free(player->values);
+    memset(player, 0, sizeof(*player));
+}
+
+void trace_player_set_write_log(struct TracePlayer* player, struct WriteLog* log) {
+    player->write_log = log;
+}
+
+void trace_player_seek(struct TracePlayer* player, long long step) {
+    step = step < 0 ? 0 : step > player->total_steps ? player->total_steps : step;
+    long long k = step / player->keyframe_interval;
+    k = k < player->num_keyframes ? k : player->num_keyframes - 1;
+    // decoding on from the current state is only worth it if no keyframe
+    // lies between it and the target
+    if (step < player->cursor.step || player->cursor.step < player->keyframes[k].cursor.step) {
+        restore_keyframe(player, (int)k);
+    }
+    advance_to(player, step);
+}
+
+long long trace_player_step(const struct TracePlayer* player) {
+    return player->cursor.step;
+}
+
+bool trace_player_done(const struct TracePlayer* player) {
+    return player->cursor.step >= player->total_steps;
+}
+
+int trace_player_highlights(const struct TracePlayer* player, struct Highlight* out) {
+    memcpy(out, player->highlights, player->num_highlights * sizeof(struct Highlight));
+    return player->num_highlights;
+}
+
+long long trace_player_comparisons(const struct TracePlayer* player) {
+    return player->cursor.comparisons;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "algorithms.h"
+#include "engine.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Traces record a run of the step engine so that it can be played back
+// without running the algorithm again, at any speed and in both directions.
+//
+// File layout, all integers are LEB128 varints unless noted:
+// - header: "AVTR", version byte, algorithm type, len, then the initial
+//   array with every value as the zigzag delta to the value before it
+// - records, the low 3 bits of the first varint are the tag (2 bits before
+//   version 3) and the rest its payload:
+//   - STEP:       count, the changes recorded since the last STEP happened
+//                 in the first of count steps, the rest changed nothing
+//   - WRITE:      zigzag(idx - idx of the previous write), followed by
+//                 zigzag(new value - old value)
+//   - HIGHLIGHTS: num, a mask with two bits per highlight (index changed,
+//                 role changed), the zigzag index delta and the
+//                 role | worker << 2 of the changed ones, or
+//                 TRACE_HIGHLIGHTS_REPEAT alone to apply the same changes
+//                 as the last full HIGHLIGHTS record again
+//   - END
+//   - COMPARE:    count, the comparisons of the step, the compared elements
+//                 are its first two highlights (since version 3)
+//   Since version 2 the records of step 0, its HIGHLIGHTS if it has any,
+//   come first and are ended by a STEP record of 0 steps.
+// - footer: total number of steps as 8 bytes little endian
+//
+// A swap shows up as the two writes it makes.
+
+#define TRACE_VERSION 3
+#define TRACE_HIGHLIGHTS_REPEAT (MAX_HIGHLIGHTS + 1)
+#define TRACE_MAX_VARINT 10
+// tag, mask and an index and role for every highlight
+#define TRACE_MAX_HIGHLIGHTS_RECORD ((2 + 2 * MAX_HIGHLIGHTS) * TRACE_MAX_VARINT)
+// the player keeps at most this many snapshots of the array for seeking...
+#define TRACE_MAX_KEYFRAMES 256
+// ...and at most this many bytes of them
+#define TRACE_KEYFRAME_MEMORY (64 << 20)
+
+struct TraceWriter {
+    FILE* file;
+    uint8_t buffer[1 << 16];
+    int buffer_len;
+    int len;
+    int* shadow; // the array as of the last recorded step
+    int last_write_idx;
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int num_highlights;
+    uint8_t last_highlights[TRACE_MAX_HIGHLIGHTS_RECORD]; // last full HIGHLIGHTS record
+    int last_highlights_len;
+    long long steps;
+    long long pending_steps; // steps not written in a STEP record yet
+    bool error;              // a write to the file failed
+};
+
+// start a trace of algorithm sorting arr, highlights are the ones before the
+// first step, returns false if the file could not be created
+bool trace_writer_open(struct TraceWriter* writer,
+                       const char* path,
+                       enum AlgorithmType algorithm,
+                       const int* arr,
+                       int len,
+                       const struct Highlight* highlights,
+                       int num_highlights);
+// record one step, log holds the indices it wrote (an overflowed log makes
+// the writer compare the whole array), highlights are the ones after it and
+// comparisons is how many it made
+void trace_writer_step(struct TraceWriter* writer,
+                       const int* arr,
+                       const struct WriteLog* log,
+                       const struct Highlight* highlights,
+                       int num_highlights,
+                       long long comparisons);
+// finish the file, returns false if any write to it failed
+bool trace_writer_close(struct TraceWriter* writer);
+
+// run engine, freshly initialized on arr, to completion one step at a time
+// and write every step to path, returns false on errors
+bool trace_record(struct Engine* engine, const int* arr, int len, const char* path);
+
+// decoder state at a record boundary
+struct TraceCursor {
+    size_t pos;
+    long long step;
+    long long pending_steps; // steps of the last STEP record not taken yet
+    int last_write_idx;
+    size_t last_highlights_pos; // of the last full HIGHLIGHTS record, 0 if none
+    long long comparisons;      // made up to step
+};
+
+struct TraceKeyframe {
+    struct TraceCursor cursor;
+    int* values;
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int num_highlights;
+};
+
+// Plays a trace back into values. Opening it decodes it once and keeps a
+// snapshot every keyframe_interval steps, seeking restores the snapshot at
+// or before the target and decodes forward from there, which also makes
+// reverse playback cheap.
+struct TracePlayer {
+    const uint8_t* data;
+    size_t size;
+    bool mapped; // data is mmapped instead of read into memory
+    int version;
+    int tag_bits; // of the first varint of a record
+    enum AlgorithmType algorithm;
+    int len;
+    long long total_steps;
+    int* values;
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int num_highlights;
+    struct TraceCursor cursor;
+    struct TraceKeyframe* keyframes;
+    int num_keyframes;
+    long long keyframe_interval;
+    struct WriteLog* write_log; // NULL unless writes are tracked
+};
+
+// returns false and prints the reason to stderr if path is not a valid trace
+bool trace_player_open(struct TracePlayer* player, const char* path, bool use_mmap);
+void trace_player_close(struct TracePlayer* player);
+// record the indices changed by seeking in log, NULL disables it
+void trace_player_set_write_log(struct TracePlayer* player, struct WriteLog* log);
+// move to the state after step steps, clamped to [0, total_steps]
+void trace_player_seek(struct TracePlayer* player, long long step);
+long long trace_player_step(const struct TracePlayer* player);
+bool trace_player_done(const struct TracePlayer* player);
+// fills out with at most MAX_HIGHLIGHTS highlights, returns how many
+int trace_player_highlights(const struct TracePlayer* player, struct Highlight* out);
+// comparisons made up to the current step, 0 for traces before version 3
+long long trace_player_comparisons(const struct TracePlayer* player);
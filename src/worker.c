@@ -0,0 +1,228 @@
+#include "worker.h"
+#include <string.h>
+#include <time.h>
+
+// values compared at once by snapshot_apply before looking at single ones
+#define APPLY_BLOCK 64
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void idle(void) {
+    struct timespec ts = {0, WORKER_IDLE_US * 1000L};
+    nanosleep(&ts, NULL);
+}
+
+// ================== Command queue ==================
+bool command_queue_push(struct CommandQueue* queue, struct WorkerCommand command) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&queue->head, memory_order_acquire) == WORKER_QUEUE_LEN) {
+        return false;
+    }
+    queue->commands[tail & (WORKER_QUEUE_LEN - 1)] = command;
+    // the command is written before the consumer can see the new tail
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool command_queue_pop(struct CommandQueue* queue, struct WorkerCommand* command) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+        return false;
+    }
+    *command = queue->commands[head & (WORKER_QUEUE_LEN - 1)];
+    // the slot is read before the producer can reuse it
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+// ================== Snapshots ==================
+// fill the back snapshot with the current state and swap it into the middle
+static void publish(struct SortWorker* worker) {
+    struct Snapshot* snapshot = &worker->snapshots[worker->back];
+    struct Engine* engine = &worker->engine;
+    memcpy(snapshot->values, worker->arr, worker->len * sizeof(int));
+    snapshot->generation = worker->generation;
+    snapshot->steps = engine->steps;
+    snapshot->done = engine_done(engine);
+    snapshot->counters = engine_counters(engine);
+    snapshot->num_highlights = engine_highlights(engine, snapshot->highlights);
+    const int* counts;
+    int num_buckets = engine_histogram(engine, &counts, &snapshot->active_bucket);
+    snapshot->num_buckets = num_buckets < HISTOGRAM_MAX_BUCKETS ? num_buckets : HISTOGRAM_MAX_BUCKETS;
+    if (snapshot->num_buckets > 0) {
+        memcpy(snapshot->histogram, counts, snapshot->num_buckets * sizeof(int));
+    }
+
+    // the snapshot is written before the renderer can take it
+    int prev = atomic_exchange_explicit(&worker->middle, worker->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+    worker->back = prev & ~SNAPSHOT_FRESH;
+}
+
+const struct Snapshot* sort_worker_snapshot(struct SortWorker* worker, bool* fresh) {
+    *fresh = (atomic_load_explicit(&worker->middle, memory_order_relaxed) & SNAPSHOT_FRESH) != 0;
+    if (*fresh) {
+        int prev = atomic_exchange_explicit(&worker->middle, worker->front, memory_order_acq_rel);
+        worker->front = prev & ~SNAPSHOT_FRESH;
+    }
+    return &worker->snapshots[worker->front];
+}
+
+void snapshot_apply(const struct Snapshot* snapshot, int* values, int len, struct WriteLog* log) {
+    // most of the array is unchanged between two frames, memcmp skips the
+    // equal blocks a lot faster than comparing value by value
+    for (int start = 0; start < len; start += APPLY_BLOCK) {
+        int end = start + APPLY_BLOCK < len ? start + APPLY_BLOCK : len;
+        if (memcmp(values + start, snapshot->values + start, (end - start) * sizeof(int)) == 0) {
+            continue;
+        }
+        for (int i = start; i < end; i++) {
+            if (values[i] != snapshot->values[i]) {
+                values[i] = snapshot->values[i];
+                log_write(log, i);
+            }
+        }
+    }
+}
+
+// ================== Worker thread ==================
+static void restart_rate(struct SortWorker* worker) {
+    worker->rate_start = now_ms();
+    worker->rate_start_steps = worker->engine.steps;
+}
+
+// returns false on WORKER_QUIT, sets *changed if the state changed
+static bool apply_command(struct SortWorker* worker, struct WorkerCommand command, bool* changed) {
+    switch (command.type) {
+    case WORKER_RUN:
+        worker->running = true;
+        restart_rate(worker);
+        break;
+    case WORKER_PAUSE:
+        worker->running = false;
+        break;
+    case WORKER_STEP:
+        worker->running = false;
+        *changed = engine_step_n(&worker->engine, 1) > 0 || *changed;
+        break;
+    case WORKER_RESET:
+        engine_free(&worker->engine);
+        generate(worker->arr,
+                 worker->len,
+                 worker->distribution,
+                 worker->min_value,
+                 worker->max_value,
+                 command.seed);
+        engine_init(&worker->engine, command.algorithm, worker->arr, worker->len);
+        engine_set_fast_path(&worker->engine, worker->fast_path);
+        worker->generation++;
+        worker->running = false;
+        *changed = true;
+        break;
+    case WORKER_SET_RATE:
+        worker->rate = command.rate;
+        restart_rate(worker);
+        break;
+    case WORKER_QUIT:
+        return false;
+    }
+    return true;
+}
+
+// steps the current rate allows now, at most WORKER_BATCH
+static long long allowed_steps(const struct SortWorker* worker) {
+    if (worker->rate <= 0.0) {
+        return WORKER_BATCH;
+    }
+    double elapsed = now_ms() - worker->rate_start;
+    long long due = (long long)(worker->rate * elapsed / 1000.0) - (worker->engine.steps - worker->rate_start_steps);
+    return due < WORKER_BATCH ? due : WORKER_BATCH;
+}
+
+static void* worker_thread(void* arg) {
+    struct SortWorker* worker = arg;
+    bool changed = false; // since the last published snapshot
+    while (true) {
+        struct WorkerCommand command;
+        bool forced = false; // publish even if the last one was not taken
+        while (command_queue_pop(&worker->commands, &command)) {
+            if (!apply_command(worker, command, &forced)) {
+                return NULL;
+            }
+        }
+        changed = changed || forced;
+
+        bool stepped = false;
+        if (worker->running && !engine_done(&worker->engine)) {
+            long long n = allowed_steps(worker);
+            if (n > 0) {
+                stepped = engine_step_n(&worker->engine, n) > 0;
+                changed = changed || stepped;
+            }
+        }
+
+        // copying the array costs O(n), only do it when the renderer took the
+        // previous snapshot, unless a command has to show up at once
+        bool taken = (atomic_load_explicit(&worker->middle, memory_order_relaxed) & SNAPSHOT_FRESH) == 0;
+        if (changed && (taken || forced || engine_done(&worker->engine))) {
+            publish(worker);
+            changed = false;
+        } else if (!stepped) {
+            idle();
+        }
+    }
+}
+
+bool sort_worker_start(struct SortWorker* worker,
+                       int len,
+                       enum Distribution distribution,
+                       int min_value,
+                       int max_value,
+                       bool fast_path) {
+    memset(worker, 0, sizeof(*worker));
+    worker->len = len;
+    worker->distribution = distribution;
+    worker->min_value = min_value;
+    worker->max_value = max_value;
+    worker->fast_path = fast_path;
+    atomic_init(&worker->commands.head, 0);
+    atomic_init(&worker->commands.tail, 0);
+    atomic_init(&worker->middle, 1);
+    worker->back = 0;
+    worker->front = 2;
+    // nothing to sort until the first reset
+    engine_init(&worker->engine, NUM_ALGORITHM_TYPES, NULL, 0);
+
+    bool ok = (worker->arr = malloc(len * sizeof(int))) != NULL;
+    for (int i = 0; i < 3; i++) {
+        ok = ok && (worker->snapshots[i].values = calloc(len, sizeof(int))) != NULL;
+    }
+    if (ok && pthread_create(&worker->thread, NULL, worker_thread, worker) == 0) {
+        return true;
+    }
+    free(worker->arr);
+    for (int i = 0; i < 3; i++) {
+        free(worker->snapshots[i].values);
+    }
+    return false;
+}
+
+bool sort_worker_send(struct SortWorker* worker, struct WorkerCommand command) {
+    return command_queue_push(&worker->commands, command);
+}
+
+void sort_worker_stop(struct SortWorker* worker) {
+    struct WorkerCommand quit = {.type = WORKER_QUIT};
+    while (!command_queue_push(&worker->commands, quit)) {
+        idle();
+    }
+    pthread_join(worker->thread, NULL);
+    engine_free(&worker->engine);
+    free(worker->arr);
+    for (int i = 0; i < 3; i++) {
+        free(worker->snapshots[i].values);
+    }
+}
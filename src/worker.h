@@ -0,0 +1,118 @@
+#pragma once
+
+#include "algorithms.h"
+#include "datagen.h"
+#include "engine.h"
+#include "raster.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Runs the step engine on a thread of its own so that stepping and drawing
+// do not wait for each other. The UI thread sends commands through a
+// single-producer single-consumer ring, the worker publishes what the
+// renderer needs through a triple buffer of snapshots. Neither side ever
+// blocks on the other: the worker always has a snapshot to write into and
+// the renderer always has the latest complete one to read.
+//
+// The worker owns the array it sorts. A reset generates the input on the
+// worker from the same seed the UI used for its own copy, so no array is
+// handed between the threads.
+
+// must be a power of two
+#define WORKER_QUEUE_LEN 64
+// steps between checking the commands and the snapshot handoff
+#define WORKER_BATCH 4096
+// how long the worker sleeps when there is nothing to do
+#define WORKER_IDLE_US 500
+
+enum WorkerCommandType {
+    WORKER_RUN,
+    WORKER_PAUSE,
+    WORKER_STEP,     // a single step, pauses
+    WORKER_RESET,    // start algorithm on the input generated from seed
+    WORKER_SET_RATE, // steps per second while running, 0 for no limit
+    WORKER_QUIT,
+};
+
+struct WorkerCommand {
+    enum WorkerCommandType type;
+    enum AlgorithmType algorithm; // WORKER_RESET
+    uint64_t seed;                // WORKER_RESET
+    double rate;                  // WORKER_SET_RATE
+};
+
+struct CommandQueue {
+    struct WorkerCommand commands[WORKER_QUEUE_LEN];
+    atomic_uint head; // next command to pop, written by the consumer
+    atomic_uint tail; // next free slot, written by the producer
+};
+
+// returns false if the queue is full
+bool command_queue_push(struct CommandQueue* queue, struct WorkerCommand command);
+// returns false if the queue is empty
+bool command_queue_pop(struct CommandQueue* queue, struct WorkerCommand* command);
+
+// everything the renderer draws of a run at one point in time
+struct Snapshot {
+    int* values;
+    long long generation; // number of resets the worker had processed
+    long long steps;
+    bool done;
+    struct Counters counters;
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    int num_highlights;
+    int histogram[HISTOGRAM_MAX_BUCKETS];
+    int num_buckets; // 0 if the algorithm has no histogram right now
+    int active_bucket;
+};
+
+// set in SortWorker.middle while it holds a snapshot the renderer has not
+// taken yet
+#define SNAPSHOT_FRESH 4
+
+struct SortWorker {
+    int len;
+    enum Distribution distribution;
+    int min_value;
+    int max_value;
+    bool fast_path;
+    pthread_t thread;
+    struct CommandQueue commands;
+
+    struct Snapshot snapshots[3];
+    atomic_int middle; // index of the snapshot between the threads | SNAPSHOT_FRESH
+    int back;          // being written by the worker
+    int front;         // being read by the renderer
+
+    // worker thread only
+    struct Engine engine;
+    int* arr;
+    long long generation;
+    bool running;
+    double rate;
+    double rate_start;          // when the current rate started, ms
+    long long rate_start_steps; // engine steps at rate_start
+};
+
+// start the worker for arrays of len values in [min_value, max_value], it
+// sorts nothing until the first WORKER_RESET, returns false if the buffers
+// could not be allocated or the thread not started
+bool sort_worker_start(struct SortWorker* worker,
+                       int len,
+                       enum Distribution distribution,
+                       int min_value,
+                       int max_value,
+                       bool fast_path);
+// send WORKER_QUIT and wait for the thread to end
+void sort_worker_stop(struct SortWorker* worker);
+// returns false if the queue is full and the command was dropped
+bool sort_worker_send(struct SortWorker* worker, struct WorkerCommand command);
+// the latest snapshot, sets *fresh if it was published since the last call,
+// never blocks
+const struct Snapshot* sort_worker_snapshot(struct SortWorker* worker, bool* fresh);
+
+// copy the values of snapshot that differ from values into it and log their
+// indices, log may be NULL
+void snapshot_apply(const struct Snapshot* snapshot, int* values, int len, struct WriteLog* log);
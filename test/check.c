@@ -0,0 +1,691 @@
+#include "../extras/extras.h"
+#include "../src/algorithms.h"
+#include "../src/datagen.h"
+#include "../src/parallel.h"
+#include "../src/radix.h"
+#include "../src/simd.h"
+#include "../src/small_sort.h"
+#include "../src/sort_types.h"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Correctness harness, built with ASan and UBSan by `make check`. Every
+// stepwise algorithm of get_algorithm and every one-shot sort is run on all
+// distributions at a fixed set of sizes (empty, tiny, primes and powers of
+// two up to --max-n) and at --rounds random sizes and value ranges. The
+// results are compared with merge_sort_recursive from extras/, which checks
+// both that they are sorted and that they are a permutation of the input.
+//
+// A stepwise algorithm is run three ways: one step() at a time, step_n with
+// random batch sizes and step_n_fast with random batch sizes at every SIMD
+// level. All of them have to end with the same array, step count and
+// counters. The batched runs also check that every element that changed
+// between two batches is in the write log, unless the log overflowed.
+//
+// Equal ints cannot be told apart, so stability is checked on the record
+// instantiation of sort_generic.h, whose merge sort promises it, with the
+// input index as payload. The double instantiation checks that NaNs end up
+// after every number.
+//
+// `make check` links with --wrap=malloc so that malloc can be made to fail.
+// Without memory the sorts have to stop early and leave a permutation of
+// their input, which is checked up to --max-quadratic-n elements.
+//
+// usage: check [--max-n N] [--max-quadratic-n N] [--max-step-n N]
+//              [--rounds N] [--seed N] [--algorithm NAME]
+//              [--distribution NAME] [--n N --min V --max V]
+//
+// Every failure prints the options that repeat just that case.
+
+// inputs take values from one of these ranges, the narrow one forces many
+// duplicates and the wide one exercises the sign bit and every radix digit
+static const int VALUE_RANGES[][2] = {
+    {0, 15},
+    {-1000, 1000},
+    {-(1 << 30), 1 << 30},
+};
+#define NUM_VALUE_RANGES (int)(sizeof(VALUE_RANGES) / sizeof(VALUE_RANGES[0]))
+
+static const int SIZES[] = {0,   1,   2,    3,    5,    7,     13,    31,     61,     64,     127,
+                            128, 257, 1021, 1024, 4093, 4096,  65521, 65536,  999983, 1000000};
+#define NUM_SIZES (int)(sizeof(SIZES) / sizeof(SIZES[0]))
+
+// capacity of the write log of the batched runs, small enough that some
+// batches overflow it
+#define CHECK_LOG_CAPACITY 512
+// every NAN_INTERVAL-th double of the NaN check is a NaN
+#define NAN_INTERVAL 7
+// thread count of the parallel one-shot sorts
+#define CHECK_THREADS 4
+
+struct CheckConfig {
+    int max_n;
+    int max_quadratic_n; // limit of the O(n^2) algorithms
+    int max_step_n;      // limit of the single step runs and the write log checks
+    int rounds;
+    uint64_t seed;
+    const char* algorithm; // NULL checks all algorithms
+    int distribution;      // -1 checks all distributions
+    int n;                 // -1 checks all sizes, otherwise only n with the range below
+    int min;
+    int max;
+};
+
+// identifies a case in failure messages
+struct Case {
+    const char* algorithm;
+    enum Distribution dist;
+    int len;
+    int min;
+    int max;
+    uint64_t seed;
+};
+
+static int failures = 0;
+static int cases = 0;
+
+static void fail(const struct Case* c, const char* what) {
+    failures++;
+    printf("FAIL %s: %s (--algorithm %s --distribution %s --n %d --min %d --max %d --seed %llu)\n",
+           c->algorithm, what, c->algorithm, distribution_name(c->dist), c->len, c->min, c->max,
+           (unsigned long long)c->seed);
+    fflush(stdout);
+}
+
+static bool selected(const struct CheckConfig* config, const char* name) {
+    return config->algorithm == NULL || strcmp(config->algorithm, name) == 0;
+}
+
+static bool is_sorted(const int* arr, int len) {
+    for (int i = 1; i < len; i++) {
+        if (arr[i - 1] > arr[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// compares arr with the sorted input, reports the first difference
+static bool check_result(const struct Case* c, const char* run, const int* arr, const int* reference) {
+    if (memcmp(arr, reference, c->len * sizeof(int)) == 0) {
+        return true;
+    }
+    char what[128];
+    const char* error = is_sorted(arr, c->len) ? "not a permutation of the input" : "not sorted";
+    snprintf(what, sizeof(what), "%s: %s", run, error);
+    fail(c, what);
+    return false;
+}
+
+// ================== Stepwise algorithms ==================
+static const bool QUADRATIC[NUM_ALGORITHM_TYPES] = {
+    [SELECTION_SORT] = true,
+    [INSERT_SORT] = true,
+    [BUBBLE_SORT] = true,
+    [BINARY_INSERT_SORT] = true,
+};
+
+enum RunMode {
+    RUN_STEP,  // one step() at a time
+    RUN_BATCH, // step_n with random batch sizes
+    RUN_FAST,  // step_n_fast with random batch sizes
+};
+
+struct RunResult {
+    long long steps;
+    struct Counters counters;
+};
+
+// an upper bound of the steps of any algorithm, a run that takes more is
+// stuck, the radix sorts also step through their buckets on every pass
+static long long max_steps(int len, bool quadratic) {
+    long long n = len + 1;
+    if (quadratic) {
+        return 4 * n * n + 64;
+    }
+    int log2 = 1;
+    while ((1LL << log2) < n) {
+        log2++;
+    }
+    return 64 * n * log2 + 64 * RADIX_BUCKETS;
+}
+
+// batch sizes from 1 up to about a million, small batches are as likely as
+// large ones
+static long long random_batch(struct Rng* rng) {
+    int bits = rng_range(rng, 0, 20);
+    return rng_range(rng, 1, 1 << bits);
+}
+
+// every index that changed since shadow was taken has to be in the log,
+// updates shadow and clears the log
+static const char* check_write_log(struct WriteLog* log, const int* arr, int* shadow, bool* logged, int len) {
+    const char* error = NULL;
+    for (int i = 0; i < log->len; i++) {
+        int idx = log->indices[i];
+        if (idx < 0 || idx >= len) {
+            return "logged a write out of bounds";
+        }
+        logged[idx] = true;
+    }
+    for (int i = 0; i < len && error == NULL; i++) {
+        if (arr[i] != shadow[i] && !log->overflow && !logged[i]) {
+            error = "changed an element without logging the write";
+        }
+        shadow[i] = arr[i];
+    }
+    for (int i = 0; i < log->len; i++) {
+        logged[log->indices[i]] = false;
+    }
+    write_log_clear(log);
+    return error;
+}
+
+// runs algorithm on arr to completion, returns what went wrong or NULL
+static const char* run_stepwise(const struct Algorithm* algorithm,
+                                int* arr,
+                                int len,
+                                enum RunMode mode,
+                                bool quadratic,
+                                bool check_log,
+                                struct Rng* rng,
+                                struct RunResult* result) {
+    void* state = calloc(1, algorithm->state_size);
+    struct WriteLog log = {0};
+    int* shadow = check_log ? malloc((len + 1) * sizeof(int)) : NULL;
+    bool* logged = check_log ? calloc(len + 1, sizeof(bool)) : NULL;
+    bool log_ok = !check_log || (write_log_init(&log, CHECK_LOG_CAPACITY) && shadow != NULL && logged != NULL);
+    if (state == NULL || !log_ok) {
+        free(state);
+        write_log_free(&log);
+        free(shadow);
+        free(logged);
+        return "could not allocate the state";
+    }
+
+    algorithm->init(state, arr, len);
+    if (check_log) {
+        memcpy(shadow, arr, len * sizeof(int));
+        algorithm->set_write_log(state, &log);
+    }
+
+    const char* error = NULL;
+    long long steps = 0;
+    long long limit = max_steps(len, quadratic);
+    struct Highlight highlights[MAX_HIGHLIGHTS];
+    while (!algorithm->done(state) && error == NULL) {
+        long long batch = mode == RUN_STEP ? 1 : random_batch(rng);
+        long long taken;
+        if (mode == RUN_STEP) {
+            algorithm->step(state);
+            taken = 1;
+        } else {
+            taken = (mode == RUN_FAST ? algorithm->step_n_fast : algorithm->step_n)(state, batch);
+        }
+        steps += taken;
+
+        int num_highlights = algorithm->highlights(state, highlights);
+        if (taken < 0 || taken > batch) {
+            error = "step_n took more steps than asked for";
+        } else if (taken < batch && !algorithm->done(state)) {
+            error = "step_n stopped before the batch or the sort was done";
+        } else if (num_highlights < 0 || num_highlights > MAX_HIGHLIGHTS) {
+            error = "returned too many highlights";
+        } else if (steps > limit) {
+            error = "does not finish";
+        } else if (check_log) {
+            error = check_write_log(&log, arr, shadow, logged, len);
+        }
+    }
+
+    result->steps = steps;
+    result->counters = *algorithm->counters(state);
+    algorithm->free(state);
+    free(state);
+    write_log_free(&log);
+    free(shadow);
+    free(logged);
+    return error;
+}
+
+static void check_stepwise(const struct CheckConfig* config,
+                           enum AlgorithmType type,
+                           const struct Case* c,
+                           const int* input,
+                           const int* reference,
+                           int* arr) {
+    const struct Algorithm* algorithm = get_algorithm(type);
+    struct Rng rng;
+    rng_seed(&rng, c->seed);
+    // single steps and the write log check, which compares the whole array
+    // after every batch, are limited to max_step_n elements
+    bool small = c->len <= config->max_step_n;
+
+    // the other runs are compared with the first one that sorted
+    struct RunResult first;
+    char first_run[64] = "";
+    enum SimdLevel level = simd_level();
+    for (enum RunMode mode = RUN_STEP; mode <= RUN_FAST; mode++) {
+        if ((mode == RUN_STEP && !small) || (mode == RUN_FAST && algorithm->step_n_fast == NULL)) {
+            continue;
+        }
+        int max_level = mode == RUN_FAST ? simd_detect() : SIMD_SCALAR;
+        for (int l = SIMD_SCALAR; l <= max_level; l++) {
+            char run[64];
+            if (mode == RUN_FAST) {
+                simd_set_level(l);
+                snprintf(run, sizeof(run), "step_n_fast at %s", simd_level_name(l));
+            } else {
+                snprintf(run, sizeof(run), mode == RUN_STEP ? "step" : "step_n");
+            }
+
+            cases++;
+            memcpy(arr, input, c->len * sizeof(int));
+            struct RunResult result;
+            bool check_log = small && mode != RUN_STEP;
+            const char* error = run_stepwise(algorithm, arr, c->len, mode, QUADRATIC[type], check_log, &rng, &result);
+            char what[192];
+            if (error != NULL) {
+                snprintf(what, sizeof(what), "%s: %s", run, error);
+                fail(c, what);
+                continue;
+            }
+            if (!check_result(c, run, arr, reference)) {
+                continue;
+            }
+            if (first_run[0] == '\0') {
+                first = result;
+                snprintf(first_run, sizeof(first_run), "%s", run);
+            } else if (result.steps != first.steps) {
+                snprintf(what, sizeof(what), "%s took %lld steps, %s %lld", run, result.steps, first_run, first.steps);
+                fail(c, what);
+            } else if (memcmp(&result.counters, &first.counters, sizeof(struct Counters)) != 0) {
+                snprintf(what, sizeof(what), "%s counted different work than %s", run, first_run);
+                fail(c, what);
+            }
+        }
+    }
+    simd_set_level(level);
+}
+
+// ================== One-shot sorts ==================
+static void run_merge_sort_iterative_v1(int* arr, int len) { merge_sort_iterative_v1(arr, len); }
+static void run_merge_sort_iterative_v2(int* arr, int len) { merge_sort_iterative_v2(arr, len); }
+static void run_quick_sort_recursive(int* arr, int len) { quick_sort_recursive(arr, 0, len - 1); }
+static void run_quick_sort_iterative(int* arr, int len) { quick_sort_iterative(arr, len); }
+static void run_parallel_merge_sort(int* arr, int len) { parallel_merge_sort(arr, len, CHECK_THREADS); }
+static void run_parallel_quick_sort(int* arr, int len) { parallel_quick_sort(arr, len, CHECK_THREADS); }
+static void run_simd_merge_sort(int* arr, int len) { simd_merge_sort(arr, len); }
+static void run_radix_lsd_sort(int* arr, int len) { radix_lsd_sort(arr, len); }
+
+struct OneShot {
+    const char* name;
+    void (*sort)(int* arr, int len);
+    bool quadratic; // also on sorted input, like the first element pivot of extras/quick_sort.c
+    bool simd;      // runs once per SIMD level
+};
+
+static const struct OneShot ONE_SHOTS[] = {
+    {"merge_sort_iterative_v1", run_merge_sort_iterative_v1, false, false},
+    {"merge_sort_iterative_v2", run_merge_sort_iterative_v2, false, false},
+    {"quick_sort_recursive", run_quick_sort_recursive, true, false},
+    {"quick_sort_iterative", run_quick_sort_iterative, true, false},
+    {"parallel_merge_sort", run_parallel_merge_sort, false, true},
+    {"parallel_quick_sort", run_parallel_quick_sort, false, true},
+    {"simd_merge_sort", run_simd_merge_sort, false, true},
+    {"simd_quick_sort", simd_quick_sort, false, true},
+    {"radix_lsd_sort", run_radix_lsd_sort, false, false},
+    {"radix_msd_sort", radix_msd_sort, false, false},
+    {"selection_sort", selection_sort, true, false},
+    {"insertion_sort", insertion_sort, true, false},
+    {"binary_insertion_sort", binary_insertion_sort, true, false},
+};
+#define NUM_ONE_SHOTS (int)(sizeof(ONE_SHOTS) / sizeof(ONE_SHOTS[0]))
+
+static void check_one_shot(const struct OneShot* sort,
+                           const struct Case* c,
+                           const int* input,
+                           const int* reference,
+                           int* arr) {
+    enum SimdLevel level = simd_level();
+    int max_level = sort->simd ? simd_detect() : SIMD_SCALAR;
+    for (int l = SIMD_SCALAR; l <= max_level; l++) {
+        simd_set_level(l);
+        cases++;
+        memcpy(arr, input, c->len * sizeof(int));
+        sort->sort(arr, c->len);
+        check_result(c, sort->simd ? simd_level_name(l) : "sort", arr, reference);
+    }
+    simd_set_level(level);
+}
+
+// ================== Generic sorts ==================
+// the keys are unsigned, offsetting the ints by INT_MIN keeps their order
+static uint64_t record_key(int value) { return (uint64_t)((int64_t)value - INT_MIN); }
+
+// the record merge sort has to keep records with equal keys in input order,
+// the intro sort only has to keep the records
+static void check_records(const struct Case* c, const int* input, const int* reference) {
+    int len = c->len;
+    struct Record16* records = malloc(len * sizeof(struct Record16));
+    bool* seen = calloc(len + 1, sizeof(bool));
+    if ((len > 0 && records == NULL) || seen == NULL) {
+        fail(c, "could not allocate the records");
+        free(records);
+        free(seen);
+        return;
+    }
+
+    for (int run = 0; run < 2; run++) {
+        cases++;
+        for (int i = 0; i < len; i++) {
+            records[i] = (struct Record16){record_key(input[i]), (uint64_t)i};
+        }
+        if (run == 0) {
+            struct Record16MergeSortState state;
+            record16_merge_sort_init(&state, records, len);
+            while (!state.done) {
+                record16_merge_sort_step_n(&state, 4096);
+            }
+            record16_merge_sort_free(&state);
+        } else {
+            record16_sort(records, len);
+        }
+
+        const char* error = NULL;
+        for (int i = 0; i < len && error == NULL; i++) {
+            uint64_t payload = records[i].payload;
+            if (records[i].key != record_key(reference[i])) {
+                error = "keys not sorted";
+            } else if (payload >= (uint64_t)len || seen[payload] || input[payload] != reference[i]) {
+                error = "records not a permutation of the input";
+            } else if (run == 0 && i > 0 && records[i].key == records[i - 1].key && payload < records[i - 1].payload) {
+                error = "equal keys out of input order";
+            }
+            if (payload < (uint64_t)len) {
+                seen[payload] = true;
+            }
+        }
+        memset(seen, 0, (len + 1) * sizeof(bool));
+        if (error != NULL) {
+            char what[128];
+            snprintf(what, sizeof(what), "%s: %s", run == 0 ? "record16_merge_sort" : "record16_sort", error);
+            fail(c, what);
+        }
+    }
+    free(records);
+    free(seen);
+}
+
+// every NAN_INTERVAL-th input is a NaN, the numbers have to come out sorted
+// followed by all the NaNs
+static void check_nans(const struct Case* c, const int* input) {
+    int len = c->len;
+    double* values = malloc(len * sizeof(double));
+    int* numbers = malloc((len + 1) * sizeof(int));
+    if ((len > 0 && values == NULL) || numbers == NULL) {
+        fail(c, "could not allocate the doubles");
+        free(values);
+        free(numbers);
+        return;
+    }
+    int num_numbers = 0;
+    for (int i = 0; i < len; i++) {
+        if (i % NAN_INTERVAL != NAN_INTERVAL - 1) {
+            numbers[num_numbers++] = input[i];
+        }
+    }
+    merge_sort_recursive(numbers, 0, num_numbers - 1);
+
+    for (int run = 0; run < 2; run++) {
+        cases++;
+        for (int i = 0; i < len; i++) {
+            values[i] = i % NAN_INTERVAL == NAN_INTERVAL - 1 ? NAN : (double)input[i];
+        }
+        if (run == 0) {
+            struct F64MergeSortState state;
+            f64_merge_sort_init(&state, values, len);
+            while (!state.done) {
+                f64_merge_sort_step_n(&state, 4096);
+            }
+            f64_merge_sort_free(&state);
+        } else {
+            f64_sort(values, len);
+        }
+
+        bool ok = true;
+        for (int i = 0; i < len && ok; i++) {
+            ok = i < num_numbers ? values[i] == numbers[i] : isnan(values[i]);
+        }
+        if (!ok) {
+            fail(c, run == 0 ? "f64_merge_sort: NaNs not after the numbers" : "f64_sort: NaNs not after the numbers");
+        }
+    }
+    free(values);
+    free(numbers);
+}
+
+// ================== Failed allocations ==================
+// every malloc of the sorts returns NULL while fail_malloc is set
+static bool fail_malloc = false;
+
+void* __real_malloc(size_t size);
+void* __wrap_malloc(size_t size) {
+    return fail_malloc ? NULL : __real_malloc(size);
+}
+
+static void check_failed_allocations(const struct CheckConfig* config,
+                                     struct Case* c,
+                                     const int* input,
+                                     const int* reference,
+                                     int* arr) {
+    int len = c->len;
+    for (int type = 0; type < NUM_ALGORITHM_TYPES; type++) {
+        const struct Algorithm* algorithm = get_algorithm(type);
+        if (algorithm == NULL || !selected(config, algorithm->name)) {
+            continue;
+        }
+        c->algorithm = algorithm->name;
+        cases++;
+        memcpy(arr, input, len * sizeof(int));
+        struct Rng rng;
+        rng_seed(&rng, c->seed);
+        struct RunResult result;
+        fail_malloc = true;
+        const char* error = run_stepwise(algorithm, arr, len, RUN_BATCH, QUADRATIC[type], false, &rng, &result);
+        fail_malloc = false;
+        if (error != NULL) {
+            char what[128];
+            snprintf(what, sizeof(what), "without memory: %s", error);
+            fail(c, what);
+            continue;
+        }
+        merge_sort_recursive(arr, 0, len - 1);
+        check_result(c, "without memory", arr, reference);
+    }
+
+    if (!selected(config, "record16")) {
+        return;
+    }
+    c->algorithm = "record16";
+    cases++;
+    struct Record16* records = malloc(len * sizeof(struct Record16));
+    if (len > 0 && records == NULL) {
+        fail(c, "could not allocate the records");
+        return;
+    }
+    for (int i = 0; i < len; i++) {
+        records[i] = (struct Record16){record_key(input[i]), (uint64_t)i};
+    }
+    struct Record16MergeSortState state;
+    fail_malloc = true;
+    record16_merge_sort_init(&state, records, len);
+    while (!state.done) {
+        record16_merge_sort_step_n(&state, 4096);
+    }
+    record16_merge_sort_free(&state);
+    fail_malloc = false;
+    // the merge sort cannot start without its scratch buffer
+    for (int i = 0; i < len; i++) {
+        if (records[i].payload != (uint64_t)i) {
+            fail(c, "record16_merge_sort without memory: records moved");
+            break;
+        }
+    }
+    free(records);
+}
+
+// ================== Cases ==================
+static void check_case(const struct CheckConfig* config,
+                       enum Distribution dist,
+                       int len,
+                       int min,
+                       int max,
+                       uint64_t seed) {
+    // exactly len elements, so that ASan catches reads one past the end
+    int* input = malloc(len * sizeof(int));
+    int* reference = malloc(len * sizeof(int));
+    int* arr = malloc(len * sizeof(int));
+    if (len > 0 && (input == NULL || reference == NULL || arr == NULL)) {
+        fprintf(stderr, "could not allocate %d elements\n", len);
+        exit(EXIT_FAILURE);
+    }
+    generate(input, len, dist, min, max, seed);
+    memcpy(reference, input, len * sizeof(int));
+    merge_sort_recursive(reference, 0, len - 1);
+
+    struct Case c = {NULL, dist, len, min, max, seed};
+    for (int type = 0; type < NUM_ALGORITHM_TYPES; type++) {
+        const struct Algorithm* algorithm = get_algorithm(type);
+        if (algorithm == NULL || !selected(config, algorithm->name) ||
+            (QUADRATIC[type] && len > config->max_quadratic_n)) {
+            continue;
+        }
+        c.algorithm = algorithm->name;
+        check_stepwise(config, type, &c, input, reference, arr);
+    }
+    for (int s = 0; s < NUM_ONE_SHOTS; s++) {
+        const struct OneShot* sort = &ONE_SHOTS[s];
+        if (!selected(config, sort->name) || (sort->quadratic && len > config->max_quadratic_n)) {
+            continue;
+        }
+        c.algorithm = sort->name;
+        check_one_shot(sort, &c, input, reference, arr);
+    }
+    if (selected(config, "record16")) {
+        c.algorithm = "record16";
+        check_records(&c, input, reference);
+    }
+    if (selected(config, "f64")) {
+        c.algorithm = "f64";
+        check_nans(&c, input);
+    }
+    if (len <= config->max_quadratic_n) {
+        check_failed_allocations(config, &c, input, reference, arr);
+    }
+
+    free(input);
+    free(reference);
+    free(arr);
+}
+
+static void check_distributions(const struct CheckConfig* config, int len, int min, int max, uint64_t seed) {
+    for (int d = 0; d < NUM_DISTRIBUTIONS; d++) {
+        if (config->distribution < 0 || config->distribution == d) {
+            check_case(config, d, len, min, max, seed);
+        }
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--max-n N] [--max-quadratic-n N] [--max-step-n N]\n"
+            "          [--rounds N] [--seed N] [--algorithm NAME]\n"
+            "          [--distribution NAME] [--n N --min V --max V]\n",
+            prog);
+}
+
+static bool parse_args(int argc, char** argv, struct CheckConfig* config) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            return false;
+        }
+        i++;
+
+        if (strcmp(arg, "--max-n") == 0) {
+            config->max_n = atoi(value);
+        } else if (strcmp(arg, "--max-quadratic-n") == 0) {
+            config->max_quadratic_n = atoi(value);
+        } else if (strcmp(arg, "--max-step-n") == 0) {
+            config->max_step_n = atoi(value);
+        } else if (strcmp(arg, "--rounds") == 0) {
+            config->rounds = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--algorithm") == 0) {
+            config->algorithm = value;
+        } else if (strcmp(arg, "--distribution") == 0) {
+            enum Distribution dist;
+            if (!parse_distribution(value, &dist)) {
+                return false;
+            }
+            config->distribution = dist;
+        } else if (strcmp(arg, "--n") == 0) {
+            config->n = atoi(value);
+        } else if (strcmp(arg, "--min") == 0) {
+            config->min = atoi(value);
+        } else if (strcmp(arg, "--max") == 0) {
+            config->max = atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return config->max_n >= 0 && config->rounds >= 0 && config->min <= config->max;
+}
+
+int main(int argc, char** argv) {
+    struct CheckConfig config = {
+        .max_n = 1000000,
+        .max_quadratic_n = 2048,
+        .max_step_n = 65536,
+        .rounds = 32,
+        .seed = 1,
+        .algorithm = NULL,
+        .distribution = -1,
+        .n = -1,
+        .min = VALUE_RANGES[1][0],
+        .max = VALUE_RANGES[1][1],
+    };
+    if (!parse_args(argc, argv, &config)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (config.n >= 0) {
+        // a single case, as printed by a failure
+        check_distributions(&config, config.n, config.min, config.max, config.seed);
+    } else {
+        // the fixed sizes cycle through the value ranges, the rounds pick
+        // size, range and seed at random
+        for (int s = 0; s < NUM_SIZES && SIZES[s] <= config.max_n; s++) {
+            const int* range = VALUE_RANGES[s % NUM_VALUE_RANGES];
+            check_distributions(&config, SIZES[s], range[0], range[1], config.seed);
+        }
+        struct Rng rng;
+        rng_seed(&rng, config.seed);
+        for (int round = 0; round < config.rounds; round++) {
+            // log-uniform up to max_n, most rounds stay small and fast
+            int bits = rng_range(&rng, 0, 20);
+            int len = rng_range(&rng, 0, (1 << bits) < config.max_n ? 1 << bits : config.max_n);
+            const int* range = VALUE_RANGES[rng_range(&rng, 0, NUM_VALUE_RANGES - 1)];
+            check_distributions(&config, len, range[0], range[1], rng_next(&rng));
+        }
+    }
+
+    printf("%d runs, %d failures\n", cases, failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}